@@ -1,27 +1,76 @@
-const fs = require('fs');
-const readline = require('readline');
+const os = require("os");
 const rocksdb = require("rocksdb");
 
+// Memory used to sort the address list before it is written into the database.
+const SORT_MEMORY_BUDGET = 1024 * 1024 * 1024;
+
+// Number of table files loaded per warmup call, between progress reports.
+const WARMUP_BATCH_SIZE = 16;
+
+// Size of the buffer that "exportKeys" fills with keys on each native call.
+const EXPORT_BATCH_BYTES = 4 * 1024 * 1024;
+
+// Threads of the libuv pool when UV_THREADPOOL_SIZE is not set.
+const UV_THREADPOOL_DEFAULT_SIZE = 4;
+
+// Column families that split the database by address type, so that each lookup only checks the files of one type. An
+// address goes into the first family whose "prefix" and, if set, "keyLength" match it, and any other address into the
+// default family. Table options set here override those of the database for that family. The search never generates
+// P2WSH or P2TR addresses, so their families are never read and need no filters.
+const ADDRESS_COLUMN_FAMILIES = {
+    p2wpkh: {prefix: "bc1q", keyLength: 42},
+    p2wsh: {prefix: "bc1q", keyLength: 62, bloomBitsPerKey: 0},
+    p2tr: {prefix: "bc1p", bloomBitsPerKey: 0},
+    p2pkh: {prefix: "1"},
+    p2sh: {prefix: "3"}
+};
+
 class RocksDB {
     db;
 
-    static async createFromFile(dbPath, addressPath) {
-        return new Promise(async (resolve, reject) => {
-            try {
-                let rocksdb = new RocksDB(dbPath);
-                await rocksdb.open();
+    static async createFromFile(dbPath, addressPath, options) {
+        // The address list is sorted natively and loaded as SST files instead of being "put" one line at a time.
+        let rocksdb = new RocksDB(dbPath);
+        await rocksdb.open(options);
+        await rocksdb.ingestFile(addressPath, {memoryBudget: SORT_MEMORY_BUDGET, value: "0"});
+        await rocksdb.finalize();
+        await rocksdb.close();
+    }
 
-                const rl = readline.createInterface({
-                    input: fs.createReadStream(addressPath, {encoding: "utf8"}),
-                    crlfDelay: Infinity
-                });
-    
-                rl.on('line', async (line) => {
-                    await rocksdb.put(line, 0);
-                });
-    
-                rl.on('close', () => {
-                    resolve();
+    static async refreshFromFile(dbPath, addressPath, options) {
+        // Only the addresses that were added to or removed from the list since the database was built are written.
+        // Nothing is written if the list is empty or would remove more than "maxDeleteFraction" of the addresses, as
+        // that is more likely a truncated download than a real update, unless "force" is set.
+        let rocksdb = new RocksDB(dbPath);
+        await rocksdb.open(options);
+        try {
+            const stats = await rocksdb.ingestFile(addressPath, {
+                memoryBudget: SORT_MEMORY_BUDGET,
+                value: "0",
+                refresh: true,
+                maxDeleteFraction: options && options.maxDeleteFraction !== undefined ? options.maxDeleteFraction : 0.1,
+                force: !!(options && options.force)
+            });
+            if(options && options.finalize) {
+                await rocksdb.finalize();
+            }
+            return stats;
+        }
+        finally {
+            await rocksdb.close();
+        }
+    }
+
+    static async sortFile(inputPath, outputPath, options) {
+        return new Promise((resolve, reject) => {
+            try {
+                rocksdb.sortFile(inputPath, outputPath, options || {}, (err, stats) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve(stats);
+                    }
                 });
             }
             catch(err) {
@@ -30,6 +79,21 @@ class RocksDB {
         });
     }
 
+    static packKeys(keys) {
+        // Packs strings into one Buffer and a Uint32Array of their offsets, as taken by "putPacked".
+        const offsets = new Uint32Array(keys.length + 1);
+        for(let i = 0; i < keys.length; i++) {
+            offsets[i + 1] = offsets[i] + Buffer.byteLength(keys[i]);
+        }
+
+        const buffer = Buffer.allocUnsafe(offsets[keys.length]);
+        for(let i = 0; i < keys.length; i++) {
+            buffer.write(keys[i], offsets[i]);
+        }
+
+        return {buffer: buffer, offsets: offsets};
+    }
+
     constructor(dbpath) {
         this.db = new rocksdb(dbpath);
     }
@@ -70,6 +134,124 @@ class RocksDB {
         });
     }
     
+    async putPacked(keys, offsets, options) {
+        // Writes all keys in one native call, with "options.value" as the value of each. "options.disableWAL" skips the
+        // write ahead log, for bulk loads that are flushed or rebuilt if interrupted.
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.putPacked(keys, offsets, options || {}, (err) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve();
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+    
+    async ingestFile(path, options) {
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.ingestFile(path, options || {}, (err, stats) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve(stats);
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+    
+    async finalize() {
+        // Compact everything into one level of non-overlapping files, so that each lookup reads at most one file.
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.finalize((err) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve();
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+
+    isFinalized() {
+        return this.db.isFinalized();
+    }
+
+    async swap(dbPath) {
+        // Switch a read only database to the one at dbPath. Lookups already running finish on the old one.
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.swap(dbPath, (err) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve();
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+
+    async warmup(options, onProgress) {
+        // Load the index and filter blocks of every table file, a batch of files at a time.
+        let totals = {files: 0, totalFiles: 0, blockBytes: 0, fileBytes: 0};
+        do {
+            const progress = await this.warmupBatch(Object.assign({}, options, {offset: totals.files, count: WARMUP_BATCH_SIZE}));
+            totals = {
+                files: progress.files,
+                totalFiles: progress.totalFiles,
+                blockBytes: totals.blockBytes + progress.blockBytes,
+                fileBytes: totals.fileBytes + progress.fileBytes
+            };
+            if(onProgress) {
+                onProgress(totals);
+            }
+        }
+        while(totals.files < totals.totalFiles);
+
+        return totals;
+    }
+
+    async warmupBatch(options) {
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.warmup(options || {}, (err, progress) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve(progress);
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+    
     async get(key, options) {
         return new Promise((resolve, reject) => {
             try {
@@ -108,6 +290,167 @@ class RocksDB {
         });
     }
     
+    async getManyWithPerf(keys, options) {
+        // Same as "getMany", but also returns the PerfContext counters of the lookups at "options.perfLevel".
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.getMany(keys, Object.assign({perfLevel: "count"}, options), (err, values, perf) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve({values: values, perf: perf});
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+
+    async exportKeys(onBatch, options) {
+        // Read every key of every column family into one reused Buffer, without creating a string per key. Each batch
+        // is passed to "onBatch" as a view of that Buffer, so it must be consumed before the promise it returns resolves.
+        // Keys are packed "options.stride" bytes apart, padded with zeros, or else each after its length as a uint32.
+        options = options || {};
+        const buffer = Buffer.allocUnsafe(options.batchBytes || EXPORT_BATCH_BYTES);
+
+        let numKeys = 0;
+        for(const columnFamily of Object.keys(await this.scanRanges({count: 1}))) {
+            const range = {columnFamily: columnFamily};
+            numKeys += await this.scanRange(this.scanIterator(range), range, buffer, options, onBatch);
+        }
+
+        return numKeys;
+    }
+
+    async parallelScan(onBatch, options) {
+        // Same as "exportKeys", but each column family is split at table file boundaries into "options.threads" ranges
+        // that are read at the same time, each by its own iterator on a thread of the libuv pool. The pool only has
+        // UV_THREADPOOL_SIZE threads (4 by default), which must be set before the pool is first used, so "threads" is
+        // capped at that. Batches of different ranges are passed to "onBatch" on the main thread, in no particular
+        // order.
+        //
+        // The iterators of all ranges are created up front, one after the other, so that their snapshots are taken
+        // together. On a read only database they all see the same keys. On a database that is written at the same
+        // time, a write may still land between two of them.
+        options = options || {};
+        const poolSize = parseInt(process.env.UV_THREADPOOL_SIZE) || UV_THREADPOOL_DEFAULT_SIZE;
+        const threads = Math.min(options.threads || os.cpus().length, poolSize);
+        const ranges = await this.scanRanges({count: threads});
+
+        const scans = [];
+        for(const columnFamily of Object.keys(ranges)) {
+            const boundaries = ranges[columnFamily];
+            for(let i = 0; i <= boundaries.length; i++) {
+                const range = {columnFamily: columnFamily};
+                if(i > 0) {
+                    range.gte = boundaries[i - 1];
+                }
+                if(i < boundaries.length) {
+                    range.lt = boundaries[i];
+                }
+                scans.push({range: range, iterator: this.scanIterator(range)});
+            }
+        }
+
+        // Run at most "threads" ranges at a time, each with its own buffer.
+        let numKeys = 0;
+        let next = 0;
+        let failed = false;
+        const runScans = async () => {
+            const buffer = Buffer.allocUnsafe(options.batchBytes || EXPORT_BATCH_BYTES);
+            while(next < scans.length && !failed) {
+                const scan = scans[next++];
+                try {
+                    const count = await this.scanRange(scan.iterator, scan.range, buffer, options, onBatch);
+                    numKeys += count;
+                }
+                catch(err) {
+                    failed = true;
+                    throw err;
+                }
+            }
+        };
+
+        try {
+            const runners = [];
+            for(let i = 0; i < Math.min(threads, scans.length); i++) {
+                runners.push(runScans());
+            }
+            await Promise.all(runners);
+        }
+        finally {
+            // Ranges that were never started after another one failed.
+            for(; next < scans.length; next++) {
+                await new Promise((resolve) => scans[next].iterator.end(() => resolve()));
+            }
+        }
+
+        return numKeys;
+    }
+
+    scanIterator(range) {
+        return this.db.iterator(Object.assign({keys: true, values: false, keyAsBuffer: true}, range));
+    }
+
+    async scanRange(iterator, range, buffer, options, onBatch) {
+        const packOptions = {stride: options.stride || 0};
+
+        let numKeys = 0;
+        try {
+            let finished = false;
+            while(!finished) {
+                const batch = await new Promise((resolve, reject) => {
+                    iterator.nextPacked(buffer, packOptions, (err, bytes, count, done) => {
+                        if(err) {
+                            reject(err);
+                        }
+                        else {
+                            resolve({bytes: bytes, count: count, finished: done});
+                        }
+                    });
+                });
+
+                if(batch.count > 0) {
+                    await onBatch(buffer.subarray(0, batch.bytes), batch.count, range.columnFamily);
+                    numKeys += batch.count;
+                }
+                finished = batch.finished;
+            }
+        }
+        finally {
+            await new Promise((resolve) => iterator.end(() => resolve()));
+        }
+
+        return numKeys;
+    }
+
+    async scanRanges(options) {
+        // Returns, for each open column family, the keys that split it into up to "options.count" ranges.
+        return new Promise((resolve, reject) => {
+            try {
+                this.db.scanRanges(options || {}, (err, ranges) => {
+                    if(err) {
+                        reject(err);
+                    }
+                    else {
+                        resolve(ranges);
+                    }
+                });
+            }
+            catch(err) {
+                reject(err);
+            }
+        });
+    }
+
+    getStatistics(reset) {
+        // Only available if the database was opened with "statistics: true".
+        return this.db.getStatistics(reset);
+    }
+
     async close() {
         return new Promise((resolve, reject) => {
             try {
@@ -127,4 +470,6 @@ class RocksDB {
     }
 }
 
+RocksDB.ADDRESS_COLUMN_FAMILIES = ADDRESS_COLUMN_FAMILIES;
+
 module.exports = RocksDB;
\ No newline at end of file
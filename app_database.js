@@ -6,5 +6,18 @@ let dbPath = "C:\\MyFolder\\DB";
 // Replace with the path to the text file listing all funded bitcoin addresses
 let addressPath = "C:\\MyFolder\\Bitcoin_addresses_LATEST.txt";
 
+// Table options used to build the database. Options that change the file format (table format, filter type, index
+// types and format version) are stored in the database files and picked up automatically when "app_search.js" opens it.
+// Use tableFormat: "plain" for a database that will be read from memory.
+// Each address type is stored in its own column family, see "ADDRESS_COLUMN_FAMILIES" in "RocksDB.js" to tune them.
+const DB_OPTIONS = {
+    tableFormat: "blockBased",
+    bloomBitsPerKey: 10,
+    filterType: "full",
+    dataBlockIndexType: "binaryAndHash",
+    formatVersion: 5,
+    columnFamilies: RocksDB.ADDRESS_COLUMN_FAMILIES
+};
+
 // Create the database
-(async () => await RocksDB.createFromFile(dbPath, addressPath))();
\ No newline at end of file
+(async () => await RocksDB.createFromFile(dbPath, addressPath, DB_OPTIONS))();
\ No newline at end of file
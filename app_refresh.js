@@ -0,0 +1,26 @@
+const RocksDB = require("./RocksDB.js");
+
+// Replace with the path to the folder where you have created the database
+let dbPath = "C:\\MyFolder\\DB";
+
+// Replace with the path to the text file listing all funded bitcoin addresses
+let addressPath = "C:\\MyFolder\\Bitcoin_addresses_LATEST.txt";
+
+// Must use the same "tableFormat" and "columnFamilies" as the "DB_OPTIONS" the database was created with in
+// "app_database.js". A database created without column families is moved into them, which writes every address once.
+// Set "finalize" to compact the database into a single level again after the update. This rewrites the whole database.
+// The update is refused if the list is empty or would remove more than "maxDeleteFraction" of the addresses. Set "force"
+// to apply it anyway, which is also needed to move a database into column families.
+const DB_OPTIONS = {
+    tableFormat: "blockBased",
+    columnFamilies: RocksDB.ADDRESS_COLUMN_FAMILIES,
+    finalize: false,
+    maxDeleteFraction: 0.1,
+    force: false
+};
+
+// Update the database
+(async () => {
+    const stats = await RocksDB.refreshFromFile(dbPath, addressPath, DB_OPTIONS);
+    console.log("Added: " + stats.added + " Removed: " + stats.deleted + " Total: " + stats.keys);
+})();
@@ -1,36 +1,108 @@
+const fs = require("fs");
+const os = require("os");
 const { Worker } = require("worker_threads");
 
+const RocksDB = require("./RocksDB.js");
+
 const bitcoin_util = require("./util/bitcoin_util.js");
 const log_util = require("./util/log_util.js");
+const metrics_util = require("./util/metrics_util.js");
+const stats_util = require("./util/stats_util.js");
+const work_util = require("./util/work_util.js");
+
+// Keys to search in total. They are handed out to the workers as they go, so that workers that finish early take over
+// the keys left to slower ones.
+const NUM_KEYS = 10000 * 32 * 4;
+const NUM_WORKERS = os.cpus().length;
+const NUM_BITS = 4;
 
-const NUM_BATCHES_PER_WORKER = 10000;
+// Each worker starts with batches of "BATCH_SIZE" keys and then resizes them to take about "TARGET_BATCH_MS" from
+// generating the keys to getting their lookups back. Larger batches spread the cost of each native call and MultiGet
+// over more keys, while smaller ones finish sooner.
 const BATCH_SIZE = 32;
-const NUM_WORKERS = 4;
-const NUM_BITS = 4;
+const MIN_BATCH_SIZE = 8;
+const MAX_BATCH_SIZE = 1024;
+const TARGET_BATCH_MS = 20;
 const TIMER_INTERVAL = 1000;
 
+// Number of batches each worker keeps looking up while it generates the addresses of the next one. With 1, each batch is
+// generated only after the lookups of the previous one have finished.
+const PIPELINE_DEPTH = 3;
+
+// Read the database through mmap. Recommended if it was built with tableFormat: "plain" and fits in memory.
+const ALLOW_MMAP_READS = false;
+
+// Let all workers share one database instance, along with its block cache, index and filter blocks.
+const SHARE_DB = true;
+
+// Load the index and filter blocks of the database before searching, so that lookups are fast from the first batch.
+// With "ALLOW_MMAP_READS", set "WARM_UP_LOCK" to also lock the database files in memory.
+const WARM_UP_DB = true;
+const WARM_UP_LOCK = false;
+
+const DB_OPTIONS = {
+    readOnly: true,
+    maxOpenFiles: 2000,
+    allowMmapReads: ALLOW_MMAP_READS,
+    shared: SHARE_DB,
+    // Lookups only check the column family of their address type. Databases created without them work too.
+    columnFamilies: RocksDB.ADDRESS_COLUMN_FAMILIES
+};
+
 const WORKER_FILE = "./worker_task.js";
 
 // Replace with the path to the folder where you have created the database
 let dbPath = "C:\\MyFolder\\DB";
 
-let keysProcessed = 0;
+// To switch the search to another database without stopping it, e.g. one refreshed with a newer address list, write the
+// path of its folder to this file. The file is checked every "TIMER_INTERVAL" and deleted once read.
+let swapFilePath = "C:\\MyFolder\\SWAP_DB.txt";
+
+// Every "TIMER_INTERVAL", a snapshot of the counters and the time histogram of each stage is written to these files, as
+// JSON and in the Prometheus text format, e.g. for the textfile collector of node_exporter. Set a path to null to skip it.
+let metricsJsonPath = "logs/metrics.json";
+let metricsPrometheusPath = null;
+
+// Workers count their keys and time each stage here instead of sending a message per batch.
+const statsBuffer = stats_util.createStats(NUM_WORKERS);
+const stats = stats_util.getStats(statsBuffer);
+
+const queueBuffer = work_util.createQueues(NUM_WORKERS, NUM_KEYS);
+
+let workers = [];
+let swapping = false;
 
 processAllKeys();
 
 async function processAllKeys() {
     init();
 
+    // With "SHARE_DB", the workers reuse this instance, so it stays open until they are done.
+    const rocksdb = new RocksDB(dbPath);
+    await rocksdb.open(DB_OPTIONS);
+
+    if(!rocksdb.isFinalized()) {
+        console.log("WARNING: The database was not finalized, so lookups may need to check several files per key. Recreate it with \"app_database.js\".");
+    }
+
+    if(WARM_UP_DB) {
+        await warmup(rocksdb);
+    }
+
     let x = new Date();
     console.log("START: " + x);
 
     const interval = setInterval(() => {
-        console.log("KEYS: " + keysProcessed + " NOW: " + new Date());
+        printStats();
+        checkSwap(rocksdb);
     }, TIMER_INTERVAL);
 
     await processKeys();
 
     clearInterval(interval);
+    printStats();
+
+    await rocksdb.close();
 
     let y = new Date();
     console.log("END: " + y);
@@ -38,6 +110,7 @@ async function processAllKeys() {
     finish();
 
     let seconds = Math.abs(y - x) / 1000;
+    const keysProcessed = stats_util.sum(stats, stats_util.KEYS);
 
     console.log("###################");
     console.log("Seconds: " + seconds);
@@ -50,25 +123,31 @@ async function processAllKeys() {
 async function processKeys() {
     let promiseArray = [];
     for(let i = 0; i < NUM_WORKERS; i++) {
-        promiseArray.push(workerFunc());
+        promiseArray.push(workerFunc(i));
     }
 
     await Promise.all(promiseArray);
 }
 
-async function workerFunc() {
+async function workerFunc(workerIndex) {
     return new Promise(async (resolve, reject) => {
         const worker = new Worker(WORKER_FILE, {
             workerData: {
                 dbPath: dbPath,
-                numBatches: NUM_BATCHES_PER_WORKER,
-                batchSize: BATCH_SIZE
+                dbOptions: DB_OPTIONS,
+                queueBuffer: queueBuffer,
+                batchSize: BATCH_SIZE,
+                minBatchSize: MIN_BATCH_SIZE,
+                maxBatchSize: MAX_BATCH_SIZE,
+                targetBatchMs: TARGET_BATCH_MS,
+                pipelineDepth: PIPELINE_DEPTH,
+                statsBuffer: statsBuffer,
+                workerIndex: workerIndex
             }
         });
-        worker.on("message", () => {
-            keysProcessed += BATCH_SIZE;
-        })
+        workers.push(worker);
         worker.on("exit", () => {
+            workers = workers.filter((w) => w !== worker);
             resolve();
         });
         worker.on("error", (err) => {
@@ -78,6 +157,74 @@ async function workerFunc() {
     });
 }
 
+function printStats() {
+    // Average time per batch of each stage, over all workers.
+    const snapshot = stats_util.snapshot(stats);
+    const batches = Math.max(snapshot.batches, 1);
+    const stageMs = (name) => (snapshot.stages[name].time / batches / 1000000).toFixed(3);
+    const lookupP99Ms = metrics_util.percentile(snapshot.stages.lookup, 0.99) / 1000000;
+
+    console.log("KEYS: " + snapshot.keys + " NOW: " + new Date() + " KEYS/BATCH: " + (snapshot.keys / batches).toFixed(1) +
+        " MS/BATCH RNG: " + stageMs("rng") + " EC: " + stageMs("ec") + " HASH: " + stageMs("hash") +
+        " ENCODE: " + stageMs("encode") + " LOOKUP: " + stageMs("lookup") + " (P99 < " + lookupP99Ms.toFixed(3) + ")" +
+        " STALL: " + stageMs("stall"));
+
+    try {
+        metrics_util.writeMetrics(snapshot, metricsJsonPath, metricsPrometheusPath);
+    }
+    catch(err) {
+        log_util.logError(err);
+    }
+}
+
+async function checkSwap(rocksdb) {
+    if(swapping || !fs.existsSync(swapFilePath)) {
+        return;
+    }
+
+    swapping = true;
+    try {
+        const newDbPath = fs.readFileSync(swapFilePath, "utf8").trim();
+        fs.unlinkSync(swapFilePath);
+
+        console.log("Swap Start: " + new Date() + " " + newDbPath);
+
+        // Open and warm up the new database here first. With "SHARE_DB", the workers then swap to this same instance.
+        await rocksdb.swap(newDbPath);
+
+        if(!rocksdb.isFinalized()) {
+            console.log("WARNING: The new database was not finalized.");
+        }
+
+        if(WARM_UP_DB) {
+            await warmup(rocksdb);
+        }
+
+        for(const worker of workers) {
+            worker.postMessage({dbPath: newDbPath});
+        }
+
+        console.log("Swap End: " + new Date());
+    }
+    catch(err) {
+        // Keep searching the current database.
+        log_util.logError(err);
+    }
+    swapping = false;
+}
+
+async function warmup(rocksdb) {
+    console.log("Warmup Start: " + new Date());
+
+    const totals = await rocksdb.warmup({lock: WARM_UP_LOCK}, (progress) => {
+        console.log("WARMUP FILES: " + progress.files + "/" + progress.totalFiles +
+            " BLOCK MB: " + (progress.blockBytes / 1048576).toFixed(1) +
+            " FILE MB: " + (progress.fileBytes / 1048576).toFixed(1));
+    });
+
+    console.log("Warmup End: " + new Date() + " Files: " + totals.totalFiles);
+}
+
 function init() {
     console.log("Init Start: " + new Date());
     bitcoin_util.init(NUM_BITS);
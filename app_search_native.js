@@ -0,0 +1,178 @@
+const os = require("os");
+
+const RocksDB = require("./RocksDB.js");
+
+const bitcoin_util = require("./util/bitcoin_util.js");
+const log_util = require("./util/log_util.js");
+const metrics_util = require("./util/metrics_util.js");
+
+// Same search as "app_search.js", but keys are generated, hashed and checked on native threads of the secp256k1 addon
+// against the addresses of the database loaded into memory. The database is only read again to verify hits.
+const NUM_KEYS = 10000 * 32 * 4;
+const NUM_THREADS = os.cpus().length;
+const BATCH_SIZE = 256;
+const NUM_BITS = 4;
+const TIMER_INTERVAL = 1000;
+
+// Counts cycles, instructions, cache misses, TLB misses and branch misses of each stage with the hardware counters of
+// each native thread. Linux only, and "kernel.perf_event_paranoid" must be 2 or less. Counters that the CPU or a virtual
+// machine does not provide are left out.
+const PERF_COUNTERS = false;
+
+const DB_OPTIONS = {
+    readOnly: true,
+    maxOpenFiles: 2000,
+    columnFamilies: RocksDB.ADDRESS_COLUMN_FAMILIES
+};
+
+// Replace with the path to the folder where you have created the database
+let dbPath = "C:\\MyFolder\\DB";
+
+// Every "TIMER_INTERVAL", the stats of the search engine, with the time histogram of each stage, are written to these
+// files, as JSON and in the Prometheus text format. Set a path to null to skip it.
+let metricsJsonPath = "logs/metrics.json";
+let metricsPrometheusPath = null;
+
+processAllKeys();
+
+async function processAllKeys() {
+    init();
+
+    const rocksdb = new RocksDB(dbPath);
+    await rocksdb.open(DB_OPTIONS);
+
+    // About 20 bytes of memory per address that the search can find.
+    console.log("Load Start: " + new Date());
+    const engine = bitcoin_util.createSearchEngine();
+    await rocksdb.exportKeys((buffer, count) => {
+        engine.addTargets(buffer, count);
+    });
+    console.log("Load End: " + new Date() + " Addresses: " + engine.stats().targets);
+
+    let x = new Date();
+    console.log("START: " + x);
+
+    const verifications = [];
+    engine.start({threads: NUM_THREADS, batchSize: BATCH_SIZE, perfCounters: PERF_COUNTERS}, (privateKey) => {
+        verifications.push(verifyHit(rocksdb, privateKey));
+    });
+
+    await new Promise((resolve) => {
+        const interval = setInterval(() => {
+            const stats = engine.stats();
+            printStats(stats);
+            if(stats.keys >= NUM_KEYS) {
+                clearInterval(interval);
+                resolve();
+            }
+        }, TIMER_INTERVAL);
+    });
+
+    // Hits found just before stopping are still reported, until the promise returned by "stop" resolves.
+    const stopped = engine.stop();
+    const finalStats = engine.stats();
+    const keysProcessed = finalStats.keys;
+
+    await stopped;
+    await Promise.all(verifications);
+
+    await rocksdb.close();
+
+    let y = new Date();
+    console.log("END: " + y);
+
+    finish();
+
+    let seconds = Math.abs(y - x) / 1000;
+
+    console.log("###################");
+    console.log("Seconds: " + seconds);
+    console.log("Keys: " + keysProcessed);
+    console.log("Seconds/Key: " + seconds / keysProcessed);
+    console.log("Keys/Second: " + keysProcessed / seconds);
+    console.log("###################");
+
+    if(finalStats.perf) {
+        printPerf(finalStats);
+    }
+}
+
+function printStats(stats) {
+    // Average time per key of each stage, over all threads.
+    const stageNs = (name) => (stats.stages[name].time / Math.max(stats.keys, 1)).toFixed(0);
+    console.log("KEYS: " + stats.keys + " NOW: " + new Date() + " NS/KEY RNG: " + stageNs("rng") + " EC: " + stageNs("ec") +
+        " HASH: " + stageNs("hash") + " CHECK: " + stageNs("check"));
+
+    try {
+        metrics_util.writeMetrics(stats, metricsJsonPath, metricsPrometheusPath);
+    }
+    catch(err) {
+        log_util.logError(err);
+    }
+}
+
+function printPerf(stats) {
+    // Instructions per cycle and misses per key of each stage, over all threads.
+    const perf = stats.perf;
+    if(perf.available.length === 0) {
+        console.log("PERF: No hardware counters available.");
+        return;
+    }
+
+    const keys = Math.max(stats.keys, 1);
+    for(const name in perf.stages) {
+        const counts = perf.stages[name];
+        let line = "PERF " + name.toUpperCase() + ":";
+        if("cycles" in counts) {
+            line += " CYCLES/KEY: " + (counts.cycles / keys).toFixed(0);
+        }
+        if("cycles" in counts && "instructions" in counts) {
+            line += " IPC: " + (counts.instructions / Math.max(counts.cycles, 1)).toFixed(2);
+        }
+        if("llcMisses" in counts) {
+            line += " LLC MISSES/KEY: " + (counts.llcMisses / keys).toFixed(2);
+        }
+        if("dtlbMisses" in counts) {
+            line += " DTLB MISSES/KEY: " + (counts.dtlbMisses / keys).toFixed(2);
+        }
+        if("branchMisses" in counts) {
+            line += " BRANCH MISSES/KEY: " + (counts.branchMisses / keys).toFixed(2);
+        }
+        console.log(line);
+    }
+}
+
+async function verifyHit(rocksdb, privateKey) {
+    // Check the addresses of the key against the database itself, the same way "worker_task.js" does.
+    try {
+        const addressArray = bitcoin_util.getAddressArray(Uint8Array.from(privateKey), 1);
+        const types = bitcoin_util.getTypeArray();
+        const values = await rocksdb.getMany(addressArray);
+        if(values && values.some(element => element)) {
+            // Write the private key along with any public keys that are in the database.
+            let infoString = "Private Key: " + privateKey.toString("hex");
+            for(let k = 0; k < addressArray.length; k++) {
+                if(values[k]) {
+                    infoString += "\n    " + types[k] + ": " + addressArray[k];
+                }
+            }
+            console.log(infoString);
+            log_util.log(infoString);
+        }
+    }
+    catch(err) {
+        log_util.logError(err);
+    }
+}
+
+function init() {
+    console.log("Init Start: " + new Date());
+    bitcoin_util.init(NUM_BITS);
+    console.log("Init End: " + new Date());
+}
+
+function finish() {
+    console.log("Finish Start: " + new Date());
+    bitcoin_util.finish();
+    console.log("Finish End: " + new Date());
+}
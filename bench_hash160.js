@@ -0,0 +1,234 @@
+const fs = require("fs");
+const path = require("path");
+const { isMainThread, parentPort, workerData } = require("worker_threads");
+
+const RocksDB = require("./RocksDB.js");
+
+const bench_util = require("./util/bench_util.js");
+const key_util = require("./util/key_util.js");
+
+// Replace with the path to a folder for the HASH160 database and the results
+let benchPath = "C:\\MyFolder\\Bench";
+
+// Measures lookups alone, on a database of "NUM_KEYS" random 20 byte keys, the size of the HASH160 of a public key,
+// generated from "SEED". Creating it takes a while at this size, so an existing one in "benchPath" is used as is. Use
+// 10 to 100 million keys to measure at the scale of the funded address list.
+const SEED = 1;
+const NUM_KEYS = 10000000;
+const WRITE_BATCH_SIZE = 100000;
+
+// Each worker looks up "NUM_BATCHES" batches of "BATCH_SIZE" keys. Keys are random misses, except for about
+// "hitFraction" of them, which are keys of the database picked at random.
+const NUM_BATCHES = 2000;
+const BATCH_SIZE = 128;
+const HIT_FRACTIONS = [0, 0.01];
+const NUM_WORKERS_LIST = bench_util.getWorkerCounts();
+const MEMORY_INTERVAL = 100;
+
+// Every combination of cache, method, hit fraction and worker count is run. A warm cache has the index and filter
+// blocks loaded and one pass of batches read before timing. A cold cache has no block cache and reads through direct
+// IO, so that every block comes from disk as it would for a database larger than memory.
+const CACHES = [
+    {name: "warm", open: {}, warm: true},
+    {name: "cold", open: {useDirectReads: true, cacheSize: 0}, warm: false}
+];
+const METHODS = [
+    {name: "multiGet", options: {}},
+    {name: "get", options: {multiGet: false}}
+];
+
+const DB_OPTIONS = {
+    tableFormat: "blockBased",
+    bloomBitsPerKey: 10,
+    filterType: "full",
+    dataBlockIndexType: "binaryAndHash",
+    formatVersion: 5
+};
+
+if(isMainThread) {
+    benchAll();
+}
+else {
+    benchWorker();
+}
+
+async function benchAll() {
+    const dbPath = path.join(benchPath, "hash160_" + NUM_KEYS + "_" + SEED);
+    if(!fs.existsSync(dbPath)) {
+        await createDatabase(dbPath);
+    }
+
+    const results = [];
+    for(const cache of CACHES) {
+        const rssBefore = process.memoryUsage().rss;
+
+        // The workers share this instance, along with its block cache.
+        const rocksdb = new RocksDB(dbPath);
+        await rocksdb.open(Object.assign({readOnly: true, maxOpenFiles: 2000, shared: true}, cache.open));
+        if(cache.warm) {
+            await rocksdb.warmup({}, () => {});
+            await runWorkers(dbPath, cache, METHODS[0], Math.max(...HIT_FRACTIONS), 1);
+        }
+        const rssOpen = process.memoryUsage().rss;
+
+        for(const method of METHODS) {
+            for(const hitFraction of HIT_FRACTIONS) {
+                for(const numWorkers of NUM_WORKERS_LIST) {
+                    const result = Object.assign({cache: cache.name, method: method.name, hitFraction: hitFraction,
+                        numWorkers: numWorkers, rssOpenMB: (rssOpen - rssBefore) / 1048576},
+                        await runWorkers(dbPath, cache, method, hitFraction, numWorkers));
+                    result.peakRssMB = (result.peakRss - rssBefore) / 1048576;
+                    delete result.peakRss;
+
+                    results.push(result);
+                    console.log(JSON.stringify(result));
+                }
+            }
+        }
+
+        await rocksdb.close();
+    }
+
+    let dbBytes = 0;
+    for(const file of fs.readdirSync(dbPath)) {
+        dbBytes += fs.statSync(path.join(dbPath, file)).size;
+    }
+
+    const environment = bench_util.getEnvironment({
+        seed: SEED,
+        numKeys: NUM_KEYS,
+        dbMB: dbBytes / 1048576,
+        numBatches: NUM_BATCHES,
+        batchSize: BATCH_SIZE
+    });
+    console.log("Results: " + bench_util.writeResults(benchPath, "bench_hash160", environment, results));
+}
+
+async function createDatabase(dbPath) {
+    console.log("Database Start: " + new Date());
+
+    const rocksdb = new RocksDB(dbPath);
+    await rocksdb.open(DB_OPTIONS);
+
+    const offsets = new Uint32Array(WRITE_BATCH_SIZE + 1);
+    for(let i = 0; i <= WRITE_BATCH_SIZE; i++) {
+        offsets[i] = 20 * i;
+    }
+
+    for(let i = 0; i < NUM_KEYS; i += WRITE_BATCH_SIZE) {
+        const count = Math.min(WRITE_BATCH_SIZE, NUM_KEYS - i);
+        const keys = Buffer.allocUnsafe(20 * count);
+        const stream = key_util.createKeys(SEED, i, count);
+        for(let j = 0; j < count; j++) {
+            keys.set(stream.subarray(32 * j, 32 * j + 20), 20 * j);
+        }
+        await rocksdb.putPacked(keys, offsets.subarray(0, count + 1), {value: "0", disableWAL: true});
+    }
+
+    // Compacts the keys into a single level of files, the same as a database built from the address list.
+    await rocksdb.finalize();
+    await rocksdb.close();
+
+    console.log("Database End: " + new Date());
+}
+
+async function runWorkers(dbPath, cache, method, hitFraction, numWorkers) {
+    let peakRss = process.memoryUsage().rss;
+    const interval = setInterval(() => {
+        peakRss = Math.max(peakRss, process.memoryUsage().rss);
+    }, MEMORY_INTERVAL);
+
+    const start = process.hrtime.bigint();
+
+    const promiseArray = [];
+    for(let i = 0; i < numWorkers; i++) {
+        promiseArray.push(bench_util.runWorker(__filename, {
+            dbPath: dbPath,
+            dbOptions: Object.assign({readOnly: true, maxOpenFiles: 2000, shared: true}, cache.open),
+            lookupOptions: method.options,
+            hitFraction: hitFraction,
+            workerIndex: i
+        }));
+    }
+    const workerResults = await Promise.all(promiseArray);
+
+    const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+    clearInterval(interval);
+
+    // Latencies of all batches of all workers, in microseconds.
+    let length = 0;
+    for(const result of workerResults) {
+        length += result.latencies.length;
+    }
+    const latencies = new Float64Array(length);
+    let offset = 0;
+    let hits = 0;
+    let expectedHits = 0;
+    for(const result of workerResults) {
+        latencies.set(result.latencies, offset);
+        offset += result.latencies.length;
+        hits += result.hits;
+        expectedHits += result.expectedHits;
+    }
+    latencies.sort();
+
+    const percentile = (p) => latencies[Math.min(latencies.length - 1, Math.floor(latencies.length * p))];
+    const numKeys = latencies.length * BATCH_SIZE;
+
+    return {
+        keys: numKeys,
+        seconds: seconds,
+        keysPerSecond: numKeys / seconds,
+        batchP50Us: percentile(0.5),
+        batchP90Us: percentile(0.9),
+        batchP99Us: percentile(0.99),
+        batchP999Us: percentile(0.999),
+        hits: hits,
+        expectedHits: expectedHits,
+        peakRss: Math.max(peakRss, process.memoryUsage().rss)
+    };
+}
+
+async function benchWorker() {
+    const rocksdb = new RocksDB(workerData.dbPath);
+    await rocksdb.open(workerData.dbOptions);
+
+    // Misses are keys of another seed, each worker with its own range of them.
+    const random = key_util.createRandom(SEED + workerData.workerIndex);
+    let missIndex = workerData.workerIndex * NUM_BATCHES * BATCH_SIZE;
+
+    const latencies = new Float64Array(NUM_BATCHES);
+    let hits = 0;
+    let expectedHits = 0;
+
+    for(let i = 0; i < NUM_BATCHES; i++) {
+        const misses = key_util.createKeys(SEED + 1, missIndex, BATCH_SIZE);
+        missIndex += BATCH_SIZE;
+
+        const batch = new Array(BATCH_SIZE);
+        for(let j = 0; j < BATCH_SIZE; j++) {
+            if(random() < workerData.hitFraction * 0x100000000) {
+                const stream = key_util.createKeys(SEED, random() % NUM_KEYS, 1);
+                batch[j] = Buffer.from(stream.buffer, 0, 20);
+                expectedHits++;
+            }
+            else {
+                batch[j] = Buffer.from(misses.buffer, 32 * j, 20);
+            }
+        }
+
+        const start = process.hrtime.bigint();
+        const values = await rocksdb.getMany(batch, workerData.lookupOptions);
+        latencies[i] = Number(process.hrtime.bigint() - start) / 1000;
+
+        for(const value of values) {
+            if(value) {
+                hits++;
+            }
+        }
+    }
+
+    await rocksdb.close();
+
+    parentPort.postMessage({latencies: latencies, hits: hits, expectedHits: expectedHits});
+}
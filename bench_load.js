@@ -0,0 +1,68 @@
+const fs = require("fs");
+const path = require("path");
+
+const RocksDB = require("./RocksDB.js");
+
+// Replace with the path to a folder where the benchmark databases can be created
+let benchPath = "C:\\MyFolder\\Bench";
+
+const NUM_KEYS = 10000000;
+const BATCH_SIZE = 100000;
+
+// Compares loading keys through the write path one JS object per key against packed Buffers written in one native
+// call per batch, with and without the write ahead log. "app_database.js" builds through "ingestFile" instead, which
+// skips the write path altogether.
+const CONFIGS = [
+    {name: "batch objects", packed: false, open: {}, write: {}},
+    {name: "packed", packed: true, open: {}, write: {}},
+    {name: "packed, no WAL, unordered", packed: true, open: {unorderedWrite: true}, write: {disableWAL: true}}
+];
+
+benchAll();
+
+async function benchAll() {
+    for(const config of CONFIGS) {
+        const dbPath = path.join(benchPath, "load");
+        fs.rmSync(dbPath, {recursive: true, force: true});
+
+        const rocksdb = new RocksDB(dbPath);
+        await rocksdb.open(config.open);
+
+        let packTime = 0;
+        const x = new Date();
+
+        for(let i = 0; i < NUM_KEYS; i += BATCH_SIZE) {
+            const keys = createKeys(i, Math.min(BATCH_SIZE, NUM_KEYS - i));
+
+            if(config.packed) {
+                const start = process.hrtime.bigint();
+                const packed = RocksDB.packKeys(keys);
+                packTime += Number(process.hrtime.bigint() - start) / 1000000;
+
+                await rocksdb.putPacked(packed.buffer, packed.offsets, Object.assign({value: "0"}, config.write));
+            }
+            else {
+                await new Promise((resolve, reject) => {
+                    rocksdb.db.batch(keys.map((key) => ({type: "put", key: key, value: "0"})), config.write, (err) => {
+                        err ? reject(err) : resolve();
+                    });
+                });
+            }
+        }
+
+        const seconds = Math.abs(new Date() - x) / 1000;
+        await rocksdb.close();
+
+        console.log(config.name + ": " + (NUM_KEYS / seconds).toFixed(0) + " keys/second, " +
+            (packTime / 1000).toFixed(1) + " seconds packing");
+    }
+}
+
+function createKeys(offset, count) {
+    // Keys shaped like P2PKH addresses, in random order like an unsorted address list.
+    const keys = new Array(count);
+    for(let i = 0; i < count; i++) {
+        keys[i] = "1" + Math.floor(Math.random() * 1e15).toString(36) + (offset + i).toString(36);
+    }
+    return keys;
+}
@@ -0,0 +1,162 @@
+const fs = require("fs");
+const path = require("path");
+
+const RocksDB = require("./RocksDB.js");
+
+const bitcoin_util = require("./util/bitcoin_util.js");
+
+// Replace with the path to the text file listing all funded bitcoin addresses
+let addressPath = "C:\\MyFolder\\Bitcoin_addresses_LATEST.txt";
+
+// Replace with the path to a folder where the benchmark databases can be created
+let benchPath = "C:\\MyFolder\\Bench";
+
+const NUM_BATCHES = 10000;
+const BATCH_SIZE = 32;
+const NUM_BITS = 4;
+const NUM_SAMPLE_ADDRESSES = 100000;
+
+// Each configuration is built into its own database and then read the way "worker_task.js" reads it.
+// Cuckoo tables require every key in a file to have the same length, so they can only be built from an address list
+// that has a single address type.
+const CONFIGS = [
+    {name: "blockBased", build: {bloomBitsPerKey: 10, filterType: "full", dataBlockIndexType: "binaryAndHash", formatVersion: 5}, read: {}},
+    {name: "blockBased+mmap", build: null, read: {allowMmapReads: true}},
+    {name: "plain+mmap", build: {tableFormat: "plain", bloomBitsPerKey: 10}, read: {allowMmapReads: true}},
+    {name: "cuckoo+mmap", build: {tableFormat: "cuckoo"}, read: {allowMmapReads: true}},
+    // Direct reads without a block cache make every hit read its data block from disk, which is the case of a database
+    // larger than memory. Lookups are compared one at a time against batched MultiGet, which uses io_uring if available.
+    {name: "blockBased cold", build: {bloomBitsPerKey: 10, filterType: "full", formatVersion: 5}, read: {useDirectReads: true, cacheSize: 0}, compareMultiGet: true}
+];
+
+benchAll();
+
+async function benchAll() {
+    bitcoin_util.init(NUM_BITS);
+
+    const hits = readSampleAddresses(addressPath, NUM_SAMPLE_ADDRESSES);
+    const misses = createMissAddresses(NUM_BATCHES * BATCH_SIZE / 4);
+
+    console.log("Hits: " + hits.length + " Misses: " + misses.length);
+    console.log("io_uring: " + require("rocksdb").ioUringAvailable());
+
+    let dbPath;
+    for(const config of CONFIGS) {
+        if(config.build) {
+            dbPath = path.join(benchPath, config.name);
+            fs.rmSync(dbPath, {recursive: true, force: true});
+
+            const x = new Date();
+            try {
+                await RocksDB.createFromFile(dbPath, addressPath, config.build);
+            }
+            catch(err) {
+                console.log(config.name + ": build failed: " + err.message);
+                dbPath = undefined;
+                continue;
+            }
+            console.log(config.name + ": built in " + Math.abs(new Date() - x) / 1000 + " seconds");
+        }
+
+        if(!dbPath) {
+            continue;
+        }
+
+        const rocksdb = new RocksDB(dbPath);
+        await rocksdb.open(Object.assign({readOnly: true, maxOpenFiles: 2000, statistics: true}, config.read));
+
+        // Warm up the cache and the mapped pages before timing anything.
+        await runBatches(rocksdb, hits, Math.floor(hits.length / BATCH_SIZE));
+        rocksdb.getStatistics(true);
+
+        printResult(config.name + " hits", await runBatches(rocksdb, hits, NUM_BATCHES));
+        printStatistics(config.name + " hits", rocksdb.getStatistics(true));
+        printResult(config.name + " misses", await runBatches(rocksdb, misses, NUM_BATCHES));
+        printStatistics(config.name + " misses", rocksdb.getStatistics(true));
+        printPerf(config.name + " misses", await rocksdb.getManyWithPerf(misses.slice(0, BATCH_SIZE)));
+
+        if(config.compareMultiGet) {
+            printResult(config.name + " hits serial", await runBatches(rocksdb, hits, NUM_BATCHES, {multiGet: false}));
+            printStatistics(config.name + " hits serial", rocksdb.getStatistics(true));
+        }
+
+        await rocksdb.close();
+    }
+
+    bitcoin_util.finish();
+}
+
+async function runBatches(rocksdb, keys, numBatches, options) {
+    const latencies = new Float64Array(numBatches);
+
+    for(let i = 0; i < numBatches; i++) {
+        const offset = (i * BATCH_SIZE) % (keys.length - BATCH_SIZE + 1);
+        const batch = keys.slice(offset, offset + BATCH_SIZE);
+
+        const start = process.hrtime.bigint();
+        await rocksdb.getMany(batch, options);
+        latencies[i] = Number(process.hrtime.bigint() - start) / 1000;
+    }
+
+    return latencies;
+}
+
+function printResult(name, latencies) {
+    latencies.sort();
+
+    let total = 0;
+    for(const latency of latencies) {
+        total += latency;
+    }
+
+    const percentile = (p) => latencies[Math.min(latencies.length - 1, Math.floor(latencies.length * p))].toFixed(1);
+
+    console.log(name + ": us/key " + (total / latencies.length / BATCH_SIZE).toFixed(3) +
+        " batch p50 " + percentile(0.5) + " p99 " + percentile(0.99) + " p99.9 " + percentile(0.999));
+}
+
+function printStatistics(name, statistics) {
+    const tickers = statistics.tickers;
+    const numKeys = tickers["rocksdb.number.keys.read"];
+
+    console.log(name + ": block cache hit " + tickers["rocksdb.block.cache.hit"] +
+        " miss " + tickers["rocksdb.block.cache.miss"] +
+        " bloom useful " + tickers["rocksdb.bloom.filter.useful"] + "/" + numKeys);
+}
+
+function printPerf(name, result) {
+    const perf = result.perf;
+
+    console.log(name + " (one batch): blocks read " + perf.block_read_count +
+        " block cache hits " + perf.block_cache_hit_count +
+        " bloom sst hit/miss " + perf.bloom_sst_hit_count + "/" + perf.bloom_sst_miss_count +
+        " key comparisons " + perf.user_key_comparison_count);
+}
+
+function readSampleAddresses(filePath, count) {
+    // Only the start of the file is read so that the sample can be taken from lists of any size.
+    const fd = fs.openSync(filePath, "r");
+    const buffer = Buffer.alloc(count * 64);
+    const size = fs.readSync(fd, buffer, 0, buffer.length, 0);
+    fs.closeSync(fd);
+
+    const lines = buffer.toString("utf8", 0, size).split("\n").map((line) => line.trim()).filter((line) => line);
+    if(size === buffer.length) {
+        // The last line may have been cut off.
+        lines.pop();
+    }
+
+    // Shuffle so that lookups do not walk the file in order.
+    for(let i = lines.length - 1; i > 0; i--) {
+        const j = Math.floor(Math.random() * (i + 1));
+        [lines[i], lines[j]] = [lines[j], lines[i]];
+    }
+
+    return lines.slice(0, count);
+}
+
+function createMissAddresses(count) {
+    // Addresses of random private keys are the lookups the search actually makes.
+    const privateKeyArray = Uint8Array.from(Array.from({length: 32 * count}, () => Math.floor(Math.random() * 256)));
+    return bitcoin_util.getAddressArray(privateKeyArray, count);
+}
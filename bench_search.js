@@ -0,0 +1,222 @@
+const fs = require("fs");
+const path = require("path");
+
+const RocksDB = require("./RocksDB.js");
+
+const bench_util = require("./util/bench_util.js");
+const bitcoin_util = require("./util/bitcoin_util.js");
+const key_util = require("./util/key_util.js");
+const metrics_util = require("./util/metrics_util.js");
+const stats_util = require("./util/stats_util.js");
+const work_util = require("./util/work_util.js");
+
+// Replace with the path to a folder where the benchmark database and results can be created
+let benchPath = "C:\\MyFolder\\Bench";
+
+// Runs the search of "app_search.js" end to end, with the same workers, on a database of random addresses and a stream
+// of private keys that are both generated from "SEED", so that every run searches the same keys in the same database.
+// The database is built once for each seed and size and reused by later runs.
+const SEED = 1;
+const NUM_ADDRESSES = 1000000;
+
+// Keys of the stream whose addresses are added to the database, so that each run has to find exactly this many hits.
+const NUM_PLANTED_HITS = 16;
+
+// Each run searches "WARMUP_KEYS" keys before it starts measuring, and then "MEASURE_KEYS" more.
+const WARMUP_KEYS = 20000;
+const MEASURE_KEYS = 100000;
+const POLL_INTERVAL = 10;
+
+// Every combination is run. Batch sizes are fixed for the whole run instead of adapting to "TARGET_BATCH_MS".
+const NUM_BITS_LIST = [4, 8, 12];
+const NUM_WORKERS_LIST = bench_util.getWorkerCounts();
+const BATCH_SIZE_LIST = [16, 64, 256];
+const PIPELINE_DEPTH = 3;
+
+const DB_OPTIONS = {
+    tableFormat: "blockBased",
+    bloomBitsPerKey: 10,
+    filterType: "full",
+    dataBlockIndexType: "binaryAndHash",
+    formatVersion: 5,
+    columnFamilies: RocksDB.ADDRESS_COLUMN_FAMILIES
+};
+
+const SEARCH_DB_OPTIONS = {
+    readOnly: true,
+    maxOpenFiles: 2000,
+    shared: true,
+    columnFamilies: RocksDB.ADDRESS_COLUMN_FAMILIES
+};
+
+const WORKER_FILE = "./worker_task.js";
+
+const BASE58_ALPHABET = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+const BECH32_ALPHABET = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+benchAll();
+
+async function benchAll() {
+    const dbPath = path.join(benchPath, "search_" + NUM_ADDRESSES + "_" + SEED);
+    const totalKeys = WARMUP_KEYS + MEASURE_KEYS;
+
+    if(!fs.existsSync(dbPath)) {
+        await createDatabase(dbPath, totalKeys);
+    }
+
+    const rocksdb = new RocksDB(dbPath);
+    await rocksdb.open(SEARCH_DB_OPTIONS);
+    await rocksdb.warmup({}, () => {});
+
+    const results = [];
+    for(const numBits of NUM_BITS_LIST) {
+        const initStart = process.hrtime.bigint();
+        bitcoin_util.init(numBits);
+        const initMs = Number(process.hrtime.bigint() - initStart) / 1000000;
+
+        for(const numWorkers of NUM_WORKERS_LIST) {
+            for(const batchSize of BATCH_SIZE_LIST) {
+                const result = Object.assign({numBits: numBits, numWorkers: numWorkers, batchSize: batchSize, initMs: initMs},
+                    await runSearch(dbPath, numWorkers, batchSize, totalKeys));
+                results.push(result);
+                console.log(JSON.stringify(result));
+            }
+        }
+
+        bitcoin_util.finish();
+    }
+
+    await rocksdb.close();
+
+    const environment = bench_util.getEnvironment({
+        seed: SEED,
+        numAddresses: NUM_ADDRESSES,
+        warmupKeys: WARMUP_KEYS,
+        measureKeys: MEASURE_KEYS,
+        pipelineDepth: PIPELINE_DEPTH
+    });
+    console.log("Results: " + bench_util.writeResults(benchPath, "bench_search", environment, results));
+}
+
+async function createDatabase(dbPath, totalKeys) {
+    console.log("Database Start: " + new Date());
+
+    const addressPath = dbPath + ".txt";
+    const fd = fs.openSync(addressPath, "w");
+
+    // Spread the planted keys over all the keys of a run, each with one of its address types.
+    const types = bitcoin_util.getTypeArray();
+    bitcoin_util.init(4);
+    for(let i = 0; i < NUM_PLANTED_HITS; i++) {
+        const keyIndex = Math.floor((i + 0.5) * totalKeys / NUM_PLANTED_HITS);
+        const addressArray = bitcoin_util.getAddressArray(key_util.createKeys(SEED, keyIndex, 1), 1);
+        fs.writeSync(fd, addressArray[i % types.length] + "\n");
+    }
+    bitcoin_util.finish();
+
+    // Random addresses shaped like those of the funded address list, with about the same mix of types.
+    const random = key_util.createRandom(SEED);
+    let lines = [];
+    for(let i = 0; i < NUM_ADDRESSES - NUM_PLANTED_HITS; i++) {
+        const type = random() % 10;
+        if(type < 5) {
+            lines.push("1" + randomString(random, BASE58_ALPHABET, 33));
+        }
+        else if(type < 8) {
+            lines.push("3" + randomString(random, BASE58_ALPHABET, 33));
+        }
+        else {
+            lines.push("bc1q" + randomString(random, BECH32_ALPHABET, 38));
+        }
+
+        if(lines.length === 100000) {
+            fs.writeSync(fd, lines.join("\n") + "\n");
+            lines = [];
+        }
+    }
+    if(lines.length > 0) {
+        fs.writeSync(fd, lines.join("\n") + "\n");
+    }
+    fs.closeSync(fd);
+
+    await RocksDB.createFromFile(dbPath, addressPath, DB_OPTIONS);
+    fs.unlinkSync(addressPath);
+
+    console.log("Database End: " + new Date());
+}
+
+function randomString(random, alphabet, length) {
+    let string = "";
+    for(let i = 0; i < length; i++) {
+        string += alphabet.charAt(random() % alphabet.length);
+    }
+    return string;
+}
+
+async function runSearch(dbPath, numWorkers, batchSize, totalKeys) {
+    const statsBuffer = stats_util.createStats(numWorkers);
+    const stats = stats_util.getStats(statsBuffer);
+    const queueBuffer = work_util.createQueues(numWorkers, totalKeys);
+    const keyCounterBuffer = key_util.createKeyCounter();
+
+    // Take the first snapshot as soon as the warm-up keys are done, and measure everything after it.
+    let warmSnapshot;
+    let warmTime;
+    const interval = setInterval(() => {
+        if(!warmSnapshot && stats_util.sum(stats, stats_util.KEYS) >= WARMUP_KEYS) {
+            warmTime = process.hrtime.bigint();
+            warmSnapshot = stats_util.snapshot(stats);
+        }
+    }, POLL_INTERVAL);
+
+    const promiseArray = [];
+    for(let i = 0; i < numWorkers; i++) {
+        promiseArray.push(bench_util.runWorker(WORKER_FILE, {
+            dbPath: dbPath,
+            dbOptions: SEARCH_DB_OPTIONS,
+            queueBuffer: queueBuffer,
+            batchSize: batchSize,
+            minBatchSize: batchSize,
+            maxBatchSize: batchSize,
+            targetBatchMs: 0,
+            pipelineDepth: PIPELINE_DEPTH,
+            statsBuffer: statsBuffer,
+            workerIndex: i,
+            keyCounterBuffer: keyCounterBuffer,
+            keySeed: SEED
+        }));
+    }
+    await Promise.all(promiseArray);
+
+    const endTime = process.hrtime.bigint();
+    clearInterval(interval);
+
+    const endSnapshot = stats_util.snapshot(stats);
+    if(!warmSnapshot) {
+        throw new Error("The run ended before the warm-up was done.");
+    }
+
+    const seconds = Number(endTime - warmTime) / 1e9;
+    const keys = endSnapshot.keys - warmSnapshot.keys;
+
+    const stages = {};
+    for(const name in endSnapshot.stages) {
+        const end = endSnapshot.stages[name];
+        const warm = warmSnapshot.stages[name];
+        const stage = {count: end.count - warm.count, time: end.time - warm.time, buckets: end.buckets.map((count, i) => count - warm.buckets[i])};
+        stages[name] = {
+            nsPerKey: stage.time / Math.max(keys, 1),
+            p50: metrics_util.percentile(stage, 0.5),
+            p99: metrics_util.percentile(stage, 0.99)
+        };
+    }
+
+    return {
+        keys: keys,
+        seconds: seconds,
+        keysPerSecond: keys / seconds,
+        hits: endSnapshot.hits,
+        expectedHits: NUM_PLANTED_HITS,
+        stages: stages
+    };
+}
@@ -0,0 +1,119 @@
+const { Worker, isMainThread, parentPort, workerData } = require("worker_threads");
+
+const RocksDB = require("./RocksDB.js");
+
+const bitcoin_util = require("./util/bitcoin_util.js");
+
+// Replace with the path to the folder where you have created the database
+let dbPath = "C:\\MyFolder\\DB";
+
+const NUM_WORKERS = 16;
+const NUM_BATCHES = 10000;
+const BATCH_SIZE = 32;
+const NUM_BITS = 4;
+const MEMORY_INTERVAL = 100;
+
+// Compares one database instance per worker against one instance shared by all workers.
+if(isMainThread) {
+    benchAll();
+}
+else {
+    benchWorker();
+}
+
+async function benchAll() {
+    // The table used by "getAddressArray" belongs to the whole process, so it is created once here, before any worker
+    // uses it, and destroyed only after all of them have exited.
+    bitcoin_util.init(NUM_BITS);
+
+    for(const shared of [false, true]) {
+        let peakRss = 0;
+        const interval = setInterval(() => {
+            peakRss = Math.max(peakRss, process.memoryUsage().rss);
+        }, MEMORY_INTERVAL);
+
+        const rssBefore = process.memoryUsage().rss;
+        const x = new Date();
+
+        const promiseArray = [];
+        for(let i = 0; i < NUM_WORKERS; i++) {
+            promiseArray.push(runWorker(shared));
+        }
+        const results = await Promise.all(promiseArray);
+
+        const seconds = Math.abs(new Date() - x) / 1000;
+        clearInterval(interval);
+
+        let openTime = 0;
+        let lookupTime = 0;
+        let rssOpen = 0;
+        for(const result of results) {
+            openTime += result.openTime;
+            lookupTime += result.lookupTime;
+            rssOpen = Math.max(rssOpen, result.rssOpen);
+        }
+
+        const numKeys = NUM_WORKERS * NUM_BATCHES * BATCH_SIZE;
+
+        console.log("###################");
+        console.log("Shared: " + shared);
+        console.log("Workers: " + NUM_WORKERS);
+        console.log("Seconds: " + seconds);
+        console.log("Open ms/Worker: " + (openTime / NUM_WORKERS).toFixed(1));
+        console.log("Lookup us/Key: " + (lookupTime * 1000 / numKeys).toFixed(3));
+        console.log("Keys/Second: " + (numKeys / seconds).toFixed(0));
+        console.log("RSS MB after open: " + ((rssOpen - rssBefore) / 1048576).toFixed(1));
+        console.log("RSS MB peak: " + ((peakRss - rssBefore) / 1048576).toFixed(1));
+        console.log("###################");
+    }
+
+    bitcoin_util.finish();
+}
+
+async function runWorker(shared) {
+    return new Promise((resolve, reject) => {
+        const worker = new Worker(__filename, {
+            workerData: {
+                dbPath: dbPath,
+                shared: shared
+            }
+        });
+        let result;
+        worker.on("message", (message) => {
+            result = message;
+        });
+        worker.on("exit", () => {
+            resolve(result);
+        });
+        worker.on("error", (err) => {
+            reject(err);
+        });
+    });
+}
+
+async function benchWorker() {
+    // Compute all addresses up front so that only the lookups are timed.
+    const privateKeyArray = Uint8Array.from(Array.from({length: 32 * NUM_BATCHES * BATCH_SIZE / 4}, () => Math.floor(Math.random() * 256)));
+    const addressArray = bitcoin_util.getAddressArray(privateKeyArray, NUM_BATCHES * BATCH_SIZE / 4);
+
+    let start = process.hrtime.bigint();
+
+    const rocksdb = new RocksDB(workerData.dbPath);
+    await rocksdb.open({readOnly: true, maxOpenFiles: 2000, shared: workerData.shared});
+
+    const openTime = Number(process.hrtime.bigint() - start) / 1000000;
+    const rssOpen = process.memoryUsage().rss;
+
+    start = process.hrtime.bigint();
+
+    for(let i = 0; i < NUM_BATCHES; i++) {
+        const offset = i * BATCH_SIZE;
+        await rocksdb.getMany(addressArray.slice(offset, offset + BATCH_SIZE));
+    }
+
+    const lookupTime = Number(process.hrtime.bigint() - start) / 1000000;
+
+    await rocksdb.close();
+
+    parentPort.postMessage({openTime: openTime, lookupTime: lookupTime, rssOpen: rssOpen});
+}
@@ -6,6 +6,7 @@
 
 // After building secp256k1_fast_unsafe, compile benchmarks with:
 //   gcc -Wall -Wno-unused-function -O2 --std=c99 -march=native -I src/ -I ./ bench_privkey.c timer.c -lgmp -o bench_privkey
+// To sweep window and batch sizes instead, use the bench_ecmult target of binding.gyp (src/bench_ecmult.c).
 
 
 #include <stdio.h>
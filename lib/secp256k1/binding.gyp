@@ -116,5 +116,43 @@
         },
       },
     },
+    {
+      # Sweeps window and batch sizes of public key creation, see src/bench_ecmult.c
+      'target_name': 'bench_ecmult',
+      'type': 'executable',
+      'sources': [
+        'src/bench_ecmult.c',
+      ],
+      'include_dirs': [
+        'src',
+        '.'
+      ],
+      'cflags': [
+        '-Wno-unused-function',
+        '-Wno-nonnull-compare',
+      ],
+      'defines': [
+        'USE_NUM_NONE=1',
+        'USE_FIELD_INV_BUILTIN=1',
+        'USE_SCALAR_INV_BUILTIN=1',
+        'ECMULT_GEN_PREC_BITS=4',
+        'ECMULT_WINDOW_SIZE=15',
+      ],
+      'conditions': [
+        ['target_arch=="x64" and OS!="win"', {
+          'defines': [
+            'HAVE___INT128=1',
+            'USE_ASM_X86_64=1',
+            'USE_FIELD_5X52=1',
+            'USE_SCALAR_4X64=1',
+          ]
+        }, {
+          'defines': [
+            'USE_FIELD_10X26=1',
+            'USE_SCALAR_8X32=1',
+          ]
+        }],
+      ],
+    },
   ],
 }
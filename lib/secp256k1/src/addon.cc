@@ -1,9 +1,11 @@
 #include <secp256k1_addon.h>
+#include <search_engine.h>
 
 #include <napi.h>
 
 Napi::Object Init(Napi::Env env, Napi::Object exports) {
   exports.Set("Secp256k1", Secp256k1Addon::Init(env));
+  exports.Set("SearchEngine", SearchEngine::Init(env));
   return exports;
 }
 
@@ -0,0 +1,365 @@
+/**********************************************************************
+ * Distributed under the MIT software license, see the accompanying   *
+ * file COPYING or http://www.opensource.org/licenses/mit-license.php.*
+ **********************************************************************/
+
+/* Sweeps the window size of secp256k1_ecmult_big and the batch size of
+ * secp256k1_ec_pubkey_create_serialized_batch, against secp256k1_ecmult_gen,
+ * and prints one row per configuration as CSV or JSON. Built by binding.gyp
+ * along with the addon:
+ *
+ *   build/Release/bench_ecmult [--bits=4-20] [--batch=1-8192] [--min-ms=200]
+ *                              [--max-table-mb=4096] [--format=csv|json]
+ *
+ * Batch sizes are swept in powers of two. Window sizes whose table would take
+ * more than --max-table-mb are skipped. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "include/secp256k1.h"
+
+#include "util.h"
+#include "field_impl.h"
+
+/* Field multiplications, squarings and inversions are counted by wrapping the
+ * functions of the field implementation before the code that calls them is
+ * included. secp256k1_fe_inv is already a macro for secp256k1_fe_inv_var.
+ * Inversions, and the multiplications that batch inversion does
+ * around them, are counted as such rather than as the operations inside. */
+static uint64_t bench_fe_muls = 0;
+static uint64_t bench_fe_sqrs = 0;
+static uint64_t bench_fe_invs = 0;
+
+static void bench_fe_mul(secp256k1_fe *r, const secp256k1_fe *a, const secp256k1_fe *b) {
+    bench_fe_muls++;
+    secp256k1_fe_mul(r, a, b);
+}
+
+static void bench_fe_sqr(secp256k1_fe *r, const secp256k1_fe *a) {
+    bench_fe_sqrs++;
+    secp256k1_fe_sqr(r, a);
+}
+
+static void bench_fe_inv_var(secp256k1_fe *r, const secp256k1_fe *a) {
+    bench_fe_invs++;
+    secp256k1_fe_inv_var(r, a);
+}
+
+static void bench_fe_inv_all_var(size_t len, secp256k1_fe *r, const secp256k1_fe *a) {
+    if (len > 0) {
+        bench_fe_muls += 3 * (len - 1);
+        bench_fe_invs++;
+    }
+    secp256k1_fe_inv_all_var(len, r, a);
+}
+
+#define secp256k1_fe_mul(r, a, b) bench_fe_mul(r, a, b)
+#define secp256k1_fe_sqr(r, a) bench_fe_sqr(r, a)
+#define secp256k1_fe_inv_var(r, a) bench_fe_inv_var(r, a)
+#define secp256k1_fe_inv_all_var(len, r, a) bench_fe_inv_all_var(len, r, a)
+
+#include "secp256k1.c"
+#include "ecmult_big_impl.h"
+#include "secp256k1_batch_impl.h"
+
+#define BENCH_FORMAT_CSV 0
+#define BENCH_FORMAT_JSON 1
+
+typedef struct {
+    unsigned int min_bits;
+    unsigned int max_bits;
+    size_t min_batch;
+    size_t max_batch;
+    double min_ms;
+    double max_table_mb;
+    int format;
+} bench_options;
+
+typedef struct {
+    const char *method;
+    unsigned int bits;
+    size_t batch;
+    uint64_t keys;
+    double ns_per_key;
+    double muls_per_key;
+    double sqrs_per_key;
+    double invs_per_key;
+    double table_mb;
+    double build_ms;
+} bench_result;
+
+typedef struct {
+    const secp256k1_context *ctx;
+    const secp256k1_ecmult_big_context *bmul;
+    secp256k1_scratch *scr;
+    unsigned char *privkeys;
+    unsigned char *pubkeys;
+    secp256k1_scalar *scalars;
+    size_t batch;
+} bench_data;
+
+static int bench_rows = 0;
+
+static double bench_now_ms(void) {
+    struct timespec now;
+#if defined(_WIN32)
+    timespec_get(&now, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &now);
+#endif
+    return (double)now.tv_sec * 1000.0 + (double)now.tv_nsec / 1000000.0;
+}
+
+/* Private keys from a fixed seed, so that every run multiplies the same keys. */
+static void bench_random_keys(unsigned char *privkeys, size_t count) {
+    static uint64_t state = 0x9e3779b97f4a7c15ULL;
+    size_t i;
+    for (i = 0; i < 32 * count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        privkeys[i] = (unsigned char)(state >> 24);
+    }
+}
+
+static void bench_run_ecmult_gen(bench_data *data) {
+    secp256k1_gej r;
+    size_t i;
+    for (i = 0; i < data->batch; i++) {
+        secp256k1_ecmult_gen(&data->ctx->ecmult_gen_ctx, &r, &data->scalars[i]);
+    }
+}
+
+static void bench_run_ecmult_big(bench_data *data) {
+    secp256k1_gej r;
+    size_t i;
+    for (i = 0; i < data->batch; i++) {
+        secp256k1_ecmult_big(data->bmul, &r, &data->scalars[i]);
+    }
+}
+
+static void bench_run_batch(bench_data *data) {
+    if (secp256k1_ec_pubkey_create_serialized_batch(data->ctx, data->bmul, data->scr, data->pubkeys,
+                                                    data->privkeys, data->batch, 0) != data->batch) {
+        fprintf(stderr, "Some keys of the batch were invalid\n");
+    }
+}
+
+/* Runs the benchmark for at least min_ms, doubling the number of runs until it
+ * does, and then counts the field operations of one more run. */
+static void bench_measure(const bench_options *options, void (*run)(bench_data*), bench_data *data, bench_result *result) {
+    uint64_t runs = 1;
+    uint64_t i;
+    double elapsed;
+
+    run(data);
+
+    while (1) {
+        double start = bench_now_ms();
+        for (i = 0; i < runs; i++) {
+            run(data);
+        }
+        elapsed = bench_now_ms() - start;
+        if (elapsed >= options->min_ms) break;
+        runs *= 2;
+    }
+
+    result->keys = runs * data->batch;
+    result->ns_per_key = elapsed * 1000000.0 / (double)result->keys;
+
+    bench_fe_muls = 0;
+    bench_fe_sqrs = 0;
+    bench_fe_invs = 0;
+    run(data);
+    result->muls_per_key = (double)bench_fe_muls / (double)data->batch;
+    result->sqrs_per_key = (double)bench_fe_sqrs / (double)data->batch;
+    result->invs_per_key = (double)bench_fe_invs / (double)data->batch;
+}
+
+static void bench_print(const bench_options *options, const bench_result *result) {
+    if (options->format == BENCH_FORMAT_JSON) {
+        printf("%s\n  {\"method\": \"%s\", \"bits\": %u, \"batch\": %lu, \"keys\": %llu, \"nsPerKey\": %.1f, "
+               "\"fieldMulsPerKey\": %.1f, \"fieldSqrsPerKey\": %.1f, \"fieldInvsPerKey\": %.4f, "
+               "\"tableMB\": %.1f, \"buildMs\": %.1f}",
+               bench_rows == 0 ? "[" : ",", result->method, result->bits, (unsigned long)result->batch,
+               (unsigned long long)result->keys, result->ns_per_key, result->muls_per_key, result->sqrs_per_key,
+               result->invs_per_key, result->table_mb, result->build_ms);
+    } else {
+        if (bench_rows == 0) {
+            printf("method,bits,batch,keys,ns_per_key,field_muls_per_key,field_sqrs_per_key,field_invs_per_key,table_mb,build_ms\n");
+        }
+        printf("%s,%u,%lu,%llu,%.1f,%.1f,%.1f,%.4f,%.1f,%.1f\n",
+               result->method, result->bits, (unsigned long)result->batch, (unsigned long long)result->keys,
+               result->ns_per_key, result->muls_per_key, result->sqrs_per_key, result->invs_per_key,
+               result->table_mb, result->build_ms);
+    }
+    fflush(stdout);
+    bench_rows++;
+}
+
+/* Memory of the table of secp256k1_ecmult_big_create for a window size. */
+static double bench_table_mb(unsigned int bits) {
+    double total_size = (double)(256 / bits) * (double)(1ULL << (bits - 1)) + (double)(1ULL << (256 % bits));
+    return (total_size * sizeof(secp256k1_ge_storage) + (256 / bits + 1) * sizeof(secp256k1_ge_storage*)) / 1048576.0;
+}
+
+/* Checks the keys of the big table against the default multiplication. */
+static int bench_verify(bench_data *data) {
+    unsigned char expected[65];
+    unsigned char actual[65];
+    size_t i;
+    for (i = 0; i < data->batch && i < 64; i++) {
+        if (secp256k1_ec_pubkey_create_serialized(data->ctx, NULL, expected, &data->privkeys[32 * i], 0) !=
+                secp256k1_ec_pubkey_create_serialized(data->ctx, data->bmul, actual, &data->privkeys[32 * i], 0) ||
+            memcmp(expected, actual, 65) != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int bench_parse_range(const char *value, double *min, double *max) {
+    char *end;
+    *min = strtod(value, &end);
+    *max = *min;
+    if (*end == '-') {
+        *max = strtod(end + 1, &end);
+    }
+    return *end == '\0' && *min <= *max;
+}
+
+static int bench_parse_options(int argc, char **argv, bench_options *options) {
+    int i;
+    double min, max;
+
+    options->min_bits = 4;
+    options->max_bits = 20;
+    options->min_batch = 1;
+    options->max_batch = 8192;
+    options->min_ms = 200;
+    options->max_table_mb = 4096;
+    options->format = BENCH_FORMAT_CSV;
+
+    for (i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--bits=", 7) == 0 && bench_parse_range(argv[i] + 7, &min, &max) && min >= 4 && max <= 62) {
+            options->min_bits = (unsigned int)min;
+            options->max_bits = (unsigned int)max;
+        } else if (strncmp(argv[i], "--batch=", 8) == 0 && bench_parse_range(argv[i] + 8, &min, &max) && min >= 1) {
+            options->min_batch = (size_t)min;
+            options->max_batch = (size_t)max;
+        } else if (strncmp(argv[i], "--min-ms=", 9) == 0) {
+            options->min_ms = atof(argv[i] + 9);
+        } else if (strncmp(argv[i], "--max-table-mb=", 15) == 0) {
+            options->max_table_mb = atof(argv[i] + 15);
+        } else if (strcmp(argv[i], "--format=csv") == 0) {
+            options->format = BENCH_FORMAT_CSV;
+        } else if (strcmp(argv[i], "--format=json") == 0) {
+            options->format = BENCH_FORMAT_JSON;
+        } else {
+            if (strcmp(argv[i], "--help") != 0) {
+                fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            }
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    bench_options options;
+    bench_data data;
+    bench_result result;
+    unsigned int bits;
+    size_t batch, i;
+
+    if (!bench_parse_options(argc, argv, &options)) {
+        fprintf(stderr, "Usage: %s [--bits=4-20] [--batch=1-8192] [--min-ms=200] [--max-table-mb=4096] [--format=csv|json]\n", argv[0]);
+        return 1;
+    }
+
+    memset(&data, 0, sizeof(data));
+    data.ctx = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+    data.privkeys = (unsigned char*)malloc(32 * options.max_batch);
+    data.pubkeys = (unsigned char*)malloc(65 * options.max_batch);
+    data.scalars = (secp256k1_scalar*)malloc(sizeof(secp256k1_scalar) * options.max_batch);
+    data.scr = secp256k1_scratch_create(data.ctx, options.max_batch);
+    if (data.privkeys == NULL || data.pubkeys == NULL || data.scalars == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    bench_random_keys(data.privkeys, options.max_batch);
+    for (i = 0; i < options.max_batch; i++) {
+        secp256k1_scalar_set_b32(&data.scalars[i], &data.privkeys[32 * i], NULL);
+    }
+
+    /* The default multiplication, with its compiled in table. */
+    memset(&result, 0, sizeof(result));
+    result.method = "ecmult_gen";
+    result.bits = ECMULT_GEN_PREC_BITS;
+    result.batch = 1;
+    data.batch = options.max_batch;
+    bench_measure(&options, bench_run_ecmult_gen, &data, &result);
+    bench_print(&options, &result);
+
+    result.method = "batch_gen";
+    for (batch = options.min_batch; batch <= options.max_batch; batch *= 2) {
+        result.batch = data.batch = batch;
+        bench_measure(&options, bench_run_batch, &data, &result);
+        bench_print(&options, &result);
+    }
+
+    for (bits = options.min_bits; bits <= options.max_bits; bits++) {
+        double start;
+        secp256k1_ecmult_big_context *bmul;
+
+        memset(&result, 0, sizeof(result));
+        result.bits = bits;
+        result.table_mb = bench_table_mb(bits);
+        if (result.table_mb > options.max_table_mb) {
+            fprintf(stderr, "Skipping %u bits, the table would take %.0f MB\n", bits, result.table_mb);
+            continue;
+        }
+
+        start = bench_now_ms();
+        bmul = secp256k1_ecmult_big_create(data.ctx, bits);
+        result.build_ms = bench_now_ms() - start;
+        data.bmul = bmul;
+
+        data.batch = options.max_batch;
+        if (!bench_verify(&data)) {
+            fprintf(stderr, "Public keys of the %u bit table do not match\n", bits);
+            return 1;
+        }
+
+        result.method = "ecmult_big";
+        result.batch = 1;
+        bench_measure(&options, bench_run_ecmult_big, &data, &result);
+        bench_print(&options, &result);
+
+        result.method = "batch_big";
+        for (batch = options.min_batch; batch <= options.max_batch; batch *= 2) {
+            result.batch = data.batch = batch;
+            bench_measure(&options, bench_run_batch, &data, &result);
+            bench_print(&options, &result);
+        }
+
+        secp256k1_ecmult_big_destroy(bmul);
+        data.bmul = NULL;
+    }
+
+    if (options.format == BENCH_FORMAT_JSON) {
+        printf("%s\n", bench_rows == 0 ? "[]" : "\n]");
+    }
+
+    secp256k1_scratch_destroy(data.scr);
+    free(data.privkeys);
+    free(data.pubkeys);
+    free(data.scalars);
+    secp256k1_context_destroy((secp256k1_context*)data.ctx);
+    return 0;
+}
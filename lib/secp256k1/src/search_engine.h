@@ -0,0 +1,125 @@
+#ifndef ADDON_SEARCH_ENGINE
+#define ADDON_SEARCH_ENGINE
+
+#include <napi.h>
+#include <../include/secp256k1.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Searches for private keys whose addresses are in a set of targets, entirely
+// on its own threads. Each thread generates random private keys, creates
+// their public keys in batches, hashes them and checks the hashes against the
+// targets, and only the keys that match are reported to JS.
+class SearchEngine : public Napi::ObjectWrap<SearchEngine> {
+ public:
+  static Napi::Value Init(Napi::Env env);
+
+  SearchEngine(const Napi::CallbackInfo& info);
+  void Finalize(Napi::Env env);
+
+  typedef std::array<unsigned char, 20> Hash160;
+
+  // Sorted hashes, indexed by their first two bytes so that a lookup only
+  // searches the hashes that share them. Build sorts and indexes the hashes
+  // added since it was last called, if any.
+  class HashSet {
+   public:
+    void Add(const Hash160& hash);
+    void Build();
+    bool Contains(const Hash160& hash) const;
+    size_t Size() const { return hashes_.size(); }
+
+   private:
+    std::vector<Hash160> hashes_;
+    std::vector<uint32_t> index_;
+    bool built_ = false;
+  };
+
+  // Stages of a batch, each timed in nanoseconds.
+  enum Stage { kRng, kEc, kHash, kCheck, kNumStages };
+
+  // Hardware counters of the calling thread, read at the boundaries of the
+  // stages of a batch. Only available on Linux, where perf_event_open counts
+  // the thread's own user space events without root as long as
+  // kernel.perf_event_paranoid is 2 or less. Counters that the CPU, the
+  // kernel or a virtual machine do not support are left out.
+  class PerfCounters {
+   public:
+    enum Counter {
+      kCycles,
+      kInstructions,
+      kLlcMisses,
+      kDtlbMisses,
+      kBranchMisses,
+      kNumCounters
+    };
+
+    PerfCounters();
+    ~PerfCounters();
+
+    // Returns whether any counter could be opened.
+    bool Open();
+    // Counters that are not open read as 0.
+    void Read(uint64_t* values) const;
+    bool IsOpen(Counter counter) const { return fds_[counter] >= 0; }
+
+   private:
+    int fds_[kNumCounters];
+    int leader_;
+    // Counters in the order that a read of the group returns them.
+    Counter order_[kNumCounters];
+    size_t numOpen_;
+  };
+
+  // The histogram of a stage starts with the total time, followed by one
+  // bucket per power of two, the same as in util/stats_util.js.
+  static const size_t kStageSize = 64;
+
+  // Keys, hits and stage times of one thread, on cache lines of their own.
+  struct alignas(64) Counters {
+    std::atomic<uint64_t> keys{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> stages[kNumStages][kStageSize] = {};
+    // Hardware counters of each stage, if requested, and which of them the
+    // thread could open, one bit per counter.
+    std::atomic<uint64_t> perf[kNumStages][PerfCounters::kNumCounters] = {};
+    std::atomic<uint32_t> perfOpen{0};
+
+    void Record(Stage stage, uint64_t time);
+    void RecordPerf(Stage stage, const uint64_t* before, const uint64_t* after);
+  };
+
+ private:
+  const secp256k1_context* ctx_;
+  // Hashes of public keys, for P2PKH and P2WPKH addresses, and of scripts,
+  // for P2SH addresses.
+  HashSet pubkeyHashes_;
+  HashSet scriptHashes_;
+  std::vector<std::thread> threads_;
+  std::unique_ptr<Counters[]> counters_;
+  size_t numCounters_;
+  std::atomic<bool> stopping_;
+  bool perfCounters_;
+  Napi::ThreadSafeFunction onHit_;
+  // The promise returned by stop, resolved once onHit_ is finalized.
+  Napi::ObjectReference stopped_;
+
+  Napi::Value AddTargets(const Napi::CallbackInfo& info);
+  Napi::Value Start(const Napi::CallbackInfo& info);
+  Napi::Value Stop(const Napi::CallbackInfo& info);
+  Napi::Value Stats(const Napi::CallbackInfo& info);
+  Napi::Value Check(const Napi::CallbackInfo& info);
+  Napi::Object PerfStats(Napi::Env env) const;
+
+  bool Hash(const unsigned char* uncompressed, Hash160* hashes) const;
+  bool Contains(const Hash160* hashes) const;
+  bool Matches(const unsigned char* uncompressed) const;
+  void Run(size_t index, size_t batchSize);
+  void StopThreads();
+};
+
+#endif  // ADDON_SEARCH_ENGINE
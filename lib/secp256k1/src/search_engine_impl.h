@@ -0,0 +1,731 @@
+#ifndef ADDON_SEARCH_ENGINE_IMPL
+#define ADDON_SEARCH_ENGINE_IMPL
+
+#include <search_engine.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "secp256k1_batch_impl.h"
+
+// Tables created by publicKeyCreateInit, or NULL to use the slower default
+// multiplication.
+extern secp256k1_ecmult_big_context* bmul;
+
+// Hashing
+static const uint32_t RIPEMD160_KL[5] = {0x00000000, 0x5A827999, 0x6ED9EBA1,
+                                         0x8F1BBCDC, 0xA953FD4E};
+static const uint32_t RIPEMD160_KR[5] = {0x50A28BE6, 0x5C4DD124, 0x6D703EF3,
+                                         0x7A6D76E9, 0x00000000};
+static const unsigned char RIPEMD160_RL[80] = {
+    0, 1,  2,  3,  4,  5,  6,  7,  8, 9,  10, 11, 12, 13, 14, 15,
+    7, 4,  13, 1,  10, 6,  15, 3,  12, 0, 9,  5,  2,  14, 11, 8,
+    3, 10, 14, 4,  9,  15, 8,  1,  2, 7,  0,  6,  13, 11, 5,  12,
+    1, 9,  11, 10, 0,  8,  12, 4,  13, 3, 7,  15, 14, 5,  6,  2,
+    4, 0,  5,  9,  7,  12, 2,  10, 14, 1, 3,  8,  11, 6,  15, 13};
+static const unsigned char RIPEMD160_RR[80] = {
+    5,  14, 7,  0, 9, 2,  11, 4,  13, 6,  15, 8,  1,  10, 3,  12,
+    6,  11, 3,  7, 0, 13, 5,  10, 14, 15, 8,  12, 4,  9,  1,  2,
+    15, 5,  1,  3, 7, 14, 6,  9,  11, 8,  12, 2,  10, 0,  4,  13,
+    8,  6,  4,  1, 3, 11, 15, 0,  5,  12, 2,  13, 9,  7,  10, 14,
+    12, 15, 10, 4, 1, 5,  8,  7,  6,  2,  13, 14, 0,  3,  9,  11};
+static const unsigned char RIPEMD160_SL[80] = {
+    11, 14, 15, 12, 5,  8,  7,  9,  11, 13, 14, 15, 6,  7,  9,  8,
+    7,  6,  8,  13, 11, 9,  7,  15, 7,  12, 15, 9,  11, 7,  13, 12,
+    11, 13, 6,  7,  14, 9,  13, 15, 14, 8,  13, 6,  5,  12, 7,  5,
+    11, 12, 14, 15, 14, 15, 9,  8,  9,  14, 5,  6,  8,  6,  5,  12,
+    9,  15, 5,  11, 6,  8,  13, 12, 5,  12, 13, 14, 11, 8,  5,  6};
+static const unsigned char RIPEMD160_SR[80] = {
+    8,  9,  9,  11, 13, 15, 15, 5,  7,  7,  8,  11, 14, 14, 12, 6,
+    9,  13, 15, 7,  12, 8,  9,  11, 7,  7,  12, 7,  6,  15, 13, 11,
+    9,  7,  15, 11, 8,  6,  6,  14, 12, 13, 5,  14, 13, 13, 7,  5,
+    15, 5,  8,  11, 14, 14, 6,  14, 6,  9,  12, 9,  12, 5,  15, 8,
+    8,  5,  12, 9,  12, 5,  14, 6,  8,  13, 6,  5,  15, 13, 11, 11};
+
+static inline uint32_t Ripemd160Rotl(uint32_t x, unsigned int n) {
+  return (x << n) | (x >> (32 - n));
+}
+
+static inline uint32_t Ripemd160F(unsigned int j, uint32_t x, uint32_t y,
+                                  uint32_t z) {
+  if (j < 16) return x ^ y ^ z;
+  if (j < 32) return (x & y) | (~x & z);
+  if (j < 48) return (x | ~y) ^ z;
+  if (j < 64) return (x & z) | (y & ~z);
+  return x ^ (y | ~z);
+}
+
+// RIPEMD-160 of a 32 byte input, which always fits in a single block.
+static void Ripemd160Of32(const unsigned char* in32, unsigned char* out20) {
+  uint32_t x[16];
+  for (int i = 0; i < 8; i++) {
+    x[i] = (uint32_t)in32[4 * i] | ((uint32_t)in32[4 * i + 1] << 8) |
+           ((uint32_t)in32[4 * i + 2] << 16) | ((uint32_t)in32[4 * i + 3] << 24);
+  }
+  x[8] = 0x80;
+  for (int i = 9; i < 14; i++) x[i] = 0;
+  x[14] = 256;
+  x[15] = 0;
+
+  uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476,
+                   0xC3D2E1F0};
+  uint32_t al = h[0], bl = h[1], cl = h[2], dl = h[3], el = h[4];
+  uint32_t ar = h[0], br = h[1], cr = h[2], dr = h[3], er = h[4];
+
+  for (unsigned int j = 0; j < 80; j++) {
+    uint32_t t = Ripemd160Rotl(al + Ripemd160F(j, bl, cl, dl) +
+                                   x[RIPEMD160_RL[j]] + RIPEMD160_KL[j / 16],
+                               RIPEMD160_SL[j]) + el;
+    al = el;
+    el = dl;
+    dl = Ripemd160Rotl(cl, 10);
+    cl = bl;
+    bl = t;
+
+    t = Ripemd160Rotl(ar + Ripemd160F(79 - j, br, cr, dr) +
+                          x[RIPEMD160_RR[j]] + RIPEMD160_KR[j / 16],
+                      RIPEMD160_SR[j]) + er;
+    ar = er;
+    er = dr;
+    dr = Ripemd160Rotl(cr, 10);
+    cr = br;
+    br = t;
+  }
+
+  const uint32_t t = h[1] + cl + dr;
+  h[1] = h[2] + dl + er;
+  h[2] = h[3] + el + ar;
+  h[3] = h[4] + al + br;
+  h[4] = h[0] + bl + cr;
+  h[0] = t;
+
+  for (int i = 0; i < 5; i++) {
+    out20[4 * i] = (unsigned char)h[i];
+    out20[4 * i + 1] = (unsigned char)(h[i] >> 8);
+    out20[4 * i + 2] = (unsigned char)(h[i] >> 16);
+    out20[4 * i + 3] = (unsigned char)(h[i] >> 24);
+  }
+}
+
+static void Sha256Of(const unsigned char* data, size_t size,
+                     unsigned char* out32) {
+  secp256k1_sha256_t sha;
+  secp256k1_sha256_initialize(&sha);
+  secp256k1_sha256_write(&sha, data, size);
+  secp256k1_sha256_finalize(&sha, out32);
+}
+
+static void Hash160Of(const unsigned char* data, size_t size,
+                      SearchEngine::Hash160* out) {
+  unsigned char sha[32];
+  Sha256Of(data, size, sha);
+  Ripemd160Of32(sha, out->data());
+}
+
+// Address decoding
+static const char* const BASE58_ALPHABET =
+    "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+static const char* const BECH32_ALPHABET = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
+
+// Decodes a Base58Check address of 25 bytes and checks its checksum.
+static bool DecodeBase58Check(const char* address, size_t size,
+                              unsigned char* out25) {
+  unsigned char bytes[25] = {0};
+
+  for (size_t i = 0; i < size; i++) {
+    const char* digit = strchr(BASE58_ALPHABET, address[i]);
+    if (address[i] == '\0' || digit == NULL) return false;
+
+    uint32_t carry = (uint32_t)(digit - BASE58_ALPHABET);
+    for (int j = 24; j >= 0; j--) {
+      carry += 58 * (uint32_t)bytes[j];
+      bytes[j] = (unsigned char)carry;
+      carry >>= 8;
+    }
+    if (carry != 0) return false;
+  }
+
+  unsigned char checksum[32];
+  Sha256Of(bytes, 21, checksum);
+  Sha256Of(checksum, 32, checksum);
+  if (memcmp(checksum, bytes + 21, 4) != 0) return false;
+
+  memcpy(out25, bytes, 25);
+  return true;
+}
+
+static uint32_t Bech32PolymodStep(uint32_t pre) {
+  const uint32_t b = pre >> 25;
+  return ((pre & 0x1ffffff) << 5) ^ (-((b >> 0) & 1) & 0x3b6a57b2UL) ^
+         (-((b >> 1) & 1) & 0x26508e6dUL) ^ (-((b >> 2) & 1) & 0x1ea119faUL) ^
+         (-((b >> 3) & 1) & 0x3d4233ddUL) ^ (-((b >> 4) & 1) & 0x2a1462b3UL);
+}
+
+// Decodes the program of a version 0 "bc1q" address of 20 bytes and checks
+// its checksum.
+static bool DecodeBech32P2wpkh(const char* address, size_t size,
+                               unsigned char* out20) {
+  if (size != 42 || strncmp(address, "bc1", 3) != 0) return false;
+
+  // The checksum of "bc" followed by the separator.
+  uint32_t chk = 1;
+  chk = Bech32PolymodStep(chk) ^ ('b' >> 5);
+  chk = Bech32PolymodStep(chk) ^ ('c' >> 5);
+  chk = Bech32PolymodStep(chk);
+  chk = Bech32PolymodStep(chk) ^ ('b' & 31);
+  chk = Bech32PolymodStep(chk) ^ ('c' & 31);
+
+  unsigned char words[39];
+  for (size_t i = 0; i < 39; i++) {
+    const char* word = strchr(BECH32_ALPHABET, address[3 + i]);
+    if (address[3 + i] == '\0' || word == NULL) return false;
+    words[i] = (unsigned char)(word - BECH32_ALPHABET);
+    chk = Bech32PolymodStep(chk) ^ words[i];
+  }
+  if (chk != 1 || words[0] != 0) return false;
+
+  // Regroup the 32 words of the program from 5 bits to 8 bits.
+  uint32_t value = 0;
+  int bits = 0;
+  size_t length = 0;
+  for (size_t i = 1; i < 33; i++) {
+    value = (value << 5) | words[i];
+    bits += 5;
+    if (bits >= 8) {
+      bits -= 8;
+      out20[length++] = (unsigned char)(value >> bits);
+    }
+  }
+
+  return length == 20;
+}
+
+// HashSet
+void SearchEngine::HashSet::Add(const Hash160& hash) {
+  hashes_.push_back(hash);
+  built_ = false;
+}
+
+void SearchEngine::HashSet::Build() {
+  if (built_) return;
+  built_ = true;
+
+  std::sort(hashes_.begin(), hashes_.end());
+  hashes_.erase(std::unique(hashes_.begin(), hashes_.end()), hashes_.end());
+
+  index_.assign(65537, 0);
+  for (const Hash160& hash : hashes_) {
+    index_[((hash[0] << 8) | hash[1]) + 1]++;
+  }
+  for (size_t i = 1; i < index_.size(); i++) {
+    index_[i] += index_[i - 1];
+  }
+}
+
+bool SearchEngine::HashSet::Contains(const Hash160& hash) const {
+  if (hashes_.empty()) return false;
+
+  const size_t prefix = (hash[0] << 8) | hash[1];
+  return std::binary_search(hashes_.begin() + index_[prefix],
+                            hashes_.begin() + index_[prefix + 1], hash);
+}
+
+// SearchEngine
+static const char* const SEARCH_ENGINE_STAGE_NAMES[SearchEngine::kNumStages] = {
+    "rng", "ec", "hash", "check"};
+
+static inline uint64_t SearchEngineNow() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Only the thread that owns the counters records to them, so relaxed adds
+// are enough for the stats to read them.
+void SearchEngine::Counters::Record(Stage stage, uint64_t time) {
+  size_t bucket = 0;
+  for (uint64_t t = time >> 1; t != 0 && bucket < kStageSize - 2; t >>= 1) {
+    bucket++;
+  }
+  stages[stage][0].fetch_add(time, std::memory_order_relaxed);
+  stages[stage][1 + bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void SearchEngine::Counters::RecordPerf(Stage stage, const uint64_t* before, const uint64_t* after) {
+  for (size_t i = 0; i < PerfCounters::kNumCounters; i++) {
+    perf[stage][i].fetch_add(after[i] - before[i], std::memory_order_relaxed);
+  }
+}
+
+// PerfCounters
+static const char* const SEARCH_ENGINE_PERF_NAMES[SearchEngine::PerfCounters::kNumCounters] = {
+    "cycles", "instructions", "llcMisses", "dtlbMisses", "branchMisses"};
+
+SearchEngine::PerfCounters::PerfCounters() : leader_(-1), numOpen_(0) {
+  for (size_t i = 0; i < kNumCounters; i++) fds_[i] = -1;
+}
+
+SearchEngine::PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+  for (size_t i = 0; i < kNumCounters; i++) {
+    if (fds_[i] >= 0) close(fds_[i]);
+  }
+#endif
+}
+
+bool SearchEngine::PerfCounters::Open() {
+#if defined(__linux__)
+  static const uint32_t types[kNumCounters] = {
+      PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE};
+  static const uint64_t configs[kNumCounters] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+      PERF_COUNT_HW_BRANCH_MISSES};
+
+  // One group, so that all counters count over the same time and are read
+  // with a single call.
+  for (size_t i = 0; i < kNumCounters; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = types[i];
+    attr.config = configs[i];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+
+    const int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0);
+    if (fd < 0) continue;
+
+    if (leader_ < 0) leader_ = fd;
+    fds_[i] = fd;
+    order_[numOpen_++] = (Counter)i;
+  }
+#endif
+  return numOpen_ > 0;
+}
+
+void SearchEngine::PerfCounters::Read(uint64_t* values) const {
+  memset(values, 0, sizeof(uint64_t) * kNumCounters);
+#if defined(__linux__)
+  if (leader_ < 0) return;
+
+  // The number of counters, followed by their values.
+  uint64_t group[1 + kNumCounters];
+  if (read(leader_, group, sizeof(group)) <= 0) return;
+  for (size_t i = 0; i < numOpen_ && i < group[0]; i++) {
+    values[order_[i]] = group[1 + i];
+  }
+#endif
+}
+
+struct SearchEngineHit {
+  unsigned char privateKey[32];
+};
+
+Napi::Value SearchEngine::Init(Napi::Env env) {
+  return DefineClass(env,
+                     "SearchEngine",
+                     {
+                         InstanceMethod("addTargets", &SearchEngine::AddTargets),
+                         InstanceMethod("start", &SearchEngine::Start),
+                         InstanceMethod("stop", &SearchEngine::Stop),
+                         InstanceMethod("stats", &SearchEngine::Stats),
+                         InstanceMethod("check", &SearchEngine::Check),
+                     });
+}
+
+SearchEngine::SearchEngine(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<SearchEngine>(info),
+      counters_(new Counters[1]),
+      numCounters_(1),
+      stopping_(false),
+      perfCounters_(false) {
+  ctx_ = secp256k1_context_create(SECP256K1_CONTEXT_SIGN);
+}
+
+void SearchEngine::Finalize(Napi::Env) {
+  StopThreads();
+  secp256k1_context_destroy(const_cast<secp256k1_context*>(ctx_));
+}
+
+// Adds the addresses of a Buffer of keys, each after its length as a little
+// endian uint32, as written by iterator.nextPacked. Addresses of types that
+// the search does not generate are skipped. Returns the number added.
+Napi::Value SearchEngine::AddTargets(const Napi::CallbackInfo& info) {
+  if (!threads_.empty()) {
+    throw Napi::Error::New(info.Env(), "Cannot add targets while running");
+  }
+
+  auto buffer = info[0].As<Napi::Buffer<const char>>();
+  auto count = info[1].As<Napi::Number>().Uint32Value();
+
+  const char* data = buffer.Data();
+  const size_t size = buffer.Length();
+  size_t offset = 0;
+  uint32_t added = 0;
+
+  for (uint32_t i = 0; i < count && offset + 4 <= size; i++) {
+    const uint32_t length = (uint32_t)(unsigned char)data[offset] |
+                            ((uint32_t)(unsigned char)data[offset + 1] << 8) |
+                            ((uint32_t)(unsigned char)data[offset + 2] << 16) |
+                            ((uint32_t)(unsigned char)data[offset + 3] << 24);
+    offset += 4;
+    if (offset + length > size) break;
+
+    const char* address = data + offset;
+    offset += length;
+
+    Hash160 hash;
+    unsigned char payload[25];
+
+    if (DecodeBech32P2wpkh(address, length, hash.data())) {
+      pubkeyHashes_.Add(hash);
+      added++;
+    } else if (length >= 26 && length <= 35 &&
+               DecodeBase58Check(address, length, payload)) {
+      memcpy(hash.data(), payload + 1, 20);
+      if (payload[0] == 0x00) {
+        pubkeyHashes_.Add(hash);
+        added++;
+      } else if (payload[0] == 0x05) {
+        scriptHashes_.Add(hash);
+        added++;
+      }
+    }
+  }
+
+  return Napi::Number::New(info.Env(), added);
+}
+
+// Starts options.threads threads that search batches of options.batchSize
+// keys until stopped, calling onHit with each private key that has an address
+// in the targets. With options.perfCounters, each thread also counts hardware
+// events per stage, returned by stats as "perf".
+Napi::Value SearchEngine::Start(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+
+  if (!threads_.empty()) {
+    throw Napi::Error::New(env, "The search engine is already running");
+  }
+
+  auto options = info[0].As<Napi::Object>();
+  auto onHit = info[1].As<Napi::Function>();
+
+  size_t numThreads = std::max(1u, std::thread::hardware_concurrency());
+  if (options.Has("threads")) {
+    numThreads = std::max(1u, options.Get("threads").As<Napi::Number>().Uint32Value());
+  }
+  size_t batchSize = 256;
+  if (options.Has("batchSize")) {
+    batchSize = std::max(1u, options.Get("batchSize").As<Napi::Number>().Uint32Value());
+  }
+
+  // Hardware counters of each stage, see PerfCounters.
+  perfCounters_ = options.Has("perfCounters") && options.Get("perfCounters").ToBoolean().Value();
+
+  pubkeyHashes_.Build();
+  scriptHashes_.Build();
+
+  // The finalizer of onHit_ only runs once every call that the threads
+  // queued has been made, which is when stop's promise resolves. Failures
+  // are ignored, as the environment may be torn down by then.
+  napi_value promise;
+  napi_deferred* stopped = new napi_deferred;
+  napi_create_promise(env, stopped, &promise);
+  stopped_ = Napi::Persistent(Napi::Object(env, promise));
+  onHit_ = Napi::ThreadSafeFunction::New(
+      env, onHit, "SearchEngine", 0, 1,
+      [](Napi::Env env, napi_deferred* stopped) {
+        napi_resolve_deferred(env, *stopped, env.Undefined());
+        delete stopped;
+      },
+      stopped);
+
+  counters_.reset(new Counters[numThreads]);
+  numCounters_ = numThreads;
+  stopping_ = false;
+
+  for (size_t i = 0; i < numThreads; i++) {
+    threads_.emplace_back(&SearchEngine::Run, this, i, batchSize);
+  }
+
+  return env.Undefined();
+}
+
+// Stops the threads once they finish their current batch. Hits that were
+// found before are still reported, and the returned promise resolves after
+// the last of them.
+Napi::Value SearchEngine::Stop(const Napi::CallbackInfo& info) {
+  StopThreads();
+  if (stopped_.IsEmpty()) {
+    Napi::Promise::Deferred stopped = Napi::Promise::Deferred::New(info.Env());
+    stopped.Resolve(info.Env().Undefined());
+    return stopped.Promise();
+  }
+  return stopped_.Value();
+}
+
+Napi::Value SearchEngine::Stats(const Napi::CallbackInfo& info) {
+  Napi::Env env = info.Env();
+  uint64_t keys = 0;
+  uint64_t hits = 0;
+  uint64_t stages[kNumStages][kStageSize] = {};
+  for (size_t i = 0; i < numCounters_; i++) {
+    keys += counters_[i].keys.load(std::memory_order_relaxed);
+    hits += counters_[i].hits.load(std::memory_order_relaxed);
+    for (size_t stage = 0; stage < kNumStages; stage++) {
+      for (size_t j = 0; j < kStageSize; j++) {
+        stages[stage][j] += counters_[i].stages[stage][j].load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // The stages have the same form as the snapshots of util/stats_util.js.
+  Napi::Object stagesObject = Napi::Object::New(env);
+  for (size_t stage = 0; stage < kNumStages; stage++) {
+    Napi::Array buckets = Napi::Array::New(env, kStageSize - 1);
+    uint64_t count = 0;
+    for (size_t j = 1; j < kStageSize; j++) {
+      buckets.Set(j - 1, Napi::Number::New(env, (double)stages[stage][j]));
+      count += stages[stage][j];
+    }
+
+    Napi::Object stageObject = Napi::Object::New(env);
+    stageObject.Set("count", Napi::Number::New(env, (double)count));
+    stageObject.Set("time", Napi::Number::New(env, (double)stages[stage][0]));
+    stageObject.Set("buckets", buckets);
+    stagesObject.Set(SEARCH_ENGINE_STAGE_NAMES[stage], stageObject);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("keys", Napi::Number::New(env, (double)keys));
+  result.Set("hits", Napi::Number::New(env, (double)hits));
+  result.Set("threads", Napi::Number::New(env, (double)threads_.size()));
+  result.Set("targets", Napi::Number::New(env, (double)(pubkeyHashes_.Size() + scriptHashes_.Size())));
+  result.Set("stages", stagesObject);
+  if (perfCounters_) result.Set("perf", PerfStats(env));
+  return result;
+}
+
+// Sums the hardware counters of each stage over all threads, with the names
+// of the counters that every thread could open in "available". The others
+// are left out, as they only count on some threads if at all.
+Napi::Object SearchEngine::PerfStats(Napi::Env env) const {
+  uint32_t open = numCounters_ > 0 ? ~0u : 0;
+  for (size_t i = 0; i < numCounters_; i++) {
+    open &= counters_[i].perfOpen.load(std::memory_order_relaxed);
+  }
+
+  Napi::Array available = Napi::Array::New(env);
+  for (size_t counter = 0; counter < PerfCounters::kNumCounters; counter++) {
+    if (open & (1u << counter)) {
+      available.Set(available.Length(), Napi::String::New(env, SEARCH_ENGINE_PERF_NAMES[counter]));
+    }
+  }
+
+  Napi::Object stagesObject = Napi::Object::New(env);
+  for (size_t stage = 0; stage < kNumStages; stage++) {
+    Napi::Object stageObject = Napi::Object::New(env);
+    for (size_t counter = 0; counter < PerfCounters::kNumCounters; counter++) {
+      if (!(open & (1u << counter))) continue;
+      uint64_t total = 0;
+      for (size_t i = 0; i < numCounters_; i++) {
+        total += counters_[i].perf[stage][counter].load(std::memory_order_relaxed);
+      }
+      stageObject.Set(SEARCH_ENGINE_PERF_NAMES[counter], Napi::Number::New(env, (double)total));
+    }
+    stagesObject.Set(SEARCH_ENGINE_STAGE_NAMES[stage], stageObject);
+  }
+
+  Napi::Object result = Napi::Object::New(env);
+  result.Set("available", available);
+  result.Set("stages", stagesObject);
+  return result;
+}
+
+// Returns the indexes of the private keys of a Buffer that have an address in
+// the targets, to check the results of the threads from JS.
+Napi::Value SearchEngine::Check(const Napi::CallbackInfo& info) {
+  // Building the targets while the threads search them would move the hashes
+  // under their lookups.
+  if (!threads_.empty()) {
+    throw Napi::Error::New(info.Env(), "Cannot check keys while running");
+  }
+
+  auto privateKeys = info[0].As<Napi::Buffer<const unsigned char>>();
+  const size_t count = privateKeys.Length() / 32;
+
+  pubkeyHashes_.Build();
+  scriptHashes_.Build();
+
+  Napi::Array result = Napi::Array::New(info.Env());
+  if (count == 0) return result;
+
+  secp256k1_scratch* scr = secp256k1_scratch_create(ctx_, count);
+  std::vector<unsigned char> publicKeys(65 * count);
+  if (secp256k1_ec_pubkey_create_serialized_batch(ctx_, bmul, scr, publicKeys.data(),
+                                                  privateKeys.Data(), count, 0) > 0) {
+    for (size_t i = 0; i < count; i++) {
+      if (Matches(&publicKeys[65 * i])) {
+        result.Set(result.Length(), Napi::Number::New(info.Env(), (double)i));
+      }
+    }
+  }
+  secp256k1_scratch_destroy(scr);
+
+  return result;
+}
+
+// Computes the hashes of the compressed key, the uncompressed key and the
+// P2WPKH script of the compressed key, in that order. Returns false for
+// invalid keys.
+bool SearchEngine::Hash(const unsigned char* uncompressed, Hash160* hashes) const {
+  // Invalid keys are left as zeros.
+  if (uncompressed[0] != 0x04) return false;
+
+  // The compressed key is the same x coordinate after a prefix for the parity
+  // of y, so only uncompressed keys need to be created.
+  unsigned char compressed[33];
+  compressed[0] = (uncompressed[64] & 1) ? 0x03 : 0x02;
+  memcpy(compressed + 1, uncompressed + 1, 32);
+
+  Hash160Of(compressed, 33, &hashes[0]);
+  Hash160Of(uncompressed, 65, &hashes[1]);
+
+  // P2SH(c) addresses hash the P2WPKH script of the compressed key.
+  unsigned char script[22] = {0x00, 0x14};
+  memcpy(script + 2, hashes[0].data(), 20);
+  Hash160Of(script, 22, &hashes[2]);
+
+  return true;
+}
+
+bool SearchEngine::Contains(const Hash160* hashes) const {
+  return pubkeyHashes_.Contains(hashes[0]) || pubkeyHashes_.Contains(hashes[1]) ||
+         scriptHashes_.Contains(hashes[2]);
+}
+
+bool SearchEngine::Matches(const unsigned char* uncompressed) const {
+  Hash160 hashes[3];
+  return Hash(uncompressed, hashes) && Contains(hashes);
+}
+
+void SearchEngine::StopThreads() {
+  if (threads_.empty()) return;
+
+  stopping_ = true;
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+
+  onHit_.Release();
+}
+
+void SearchEngine::Run(size_t index, size_t batchSize) {
+  Counters& counters = counters_[index];
+
+  // Private keys come from an HMAC-DRBG that is seeded once per thread, as
+  // random_device may read from the OS for every 4 bytes.
+  secp256k1_rfc6979_hmac_sha256_t rng;
+  {
+    std::random_device random;
+    unsigned char seed[32];
+    for (size_t i = 0; i < sizeof(seed); i += 4) {
+      const uint32_t value = random();
+      memcpy(&seed[i], &value, 4);
+    }
+    secp256k1_rfc6979_hmac_sha256_initialize(&rng, seed, sizeof(seed));
+    memset(seed, 0, sizeof(seed));
+  }
+
+  secp256k1_scratch* scr = secp256k1_scratch_create(ctx_, batchSize);
+  std::vector<unsigned char> privateKeys(32 * batchSize);
+  std::vector<unsigned char> publicKeys(65 * batchSize);
+  std::vector<Hash160> hashes(3 * batchSize);
+  std::vector<unsigned char> valid(batchSize);
+
+  PerfCounters perf;
+  const bool perfOpen = perfCounters_ && perf.Open();
+  uint32_t perfOpenMask = 0;
+  for (size_t counter = 0; perfOpen && counter < PerfCounters::kNumCounters; counter++) {
+    if (perf.IsOpen((PerfCounters::Counter)counter)) perfOpenMask |= 1u << counter;
+  }
+  counters.perfOpen.store(perfOpenMask, std::memory_order_relaxed);
+
+  // Reads the counters at the end of a stage and adds what they counted since
+  // the end of the previous one.
+  uint64_t perfBefore[PerfCounters::kNumCounters];
+  uint64_t perfAfter[PerfCounters::kNumCounters];
+  auto recordPerf = [&](Stage stage) {
+    if (!perfOpen) return;
+    perf.Read(perfAfter);
+    counters.RecordPerf(stage, perfBefore, perfAfter);
+    memcpy(perfBefore, perfAfter, sizeof(perfBefore));
+  };
+
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    if (perfOpen) perf.Read(perfBefore);
+    const uint64_t start = SearchEngineNow();
+
+    secp256k1_rfc6979_hmac_sha256_generate(&rng, privateKeys.data(), privateKeys.size());
+
+    const uint64_t rngEnd = SearchEngineNow();
+    counters.Record(kRng, rngEnd - start);
+    recordPerf(kRng);
+
+    if (secp256k1_ec_pubkey_create_serialized_batch(ctx_, bmul, scr, publicKeys.data(),
+                                                    privateKeys.data(), batchSize, 0) == 0) {
+      continue;
+    }
+
+    const uint64_t ecEnd = SearchEngineNow();
+    counters.Record(kEc, ecEnd - rngEnd);
+    recordPerf(kEc);
+
+    for (size_t i = 0; i < batchSize; i++) {
+      valid[i] = Hash(&publicKeys[65 * i], &hashes[3 * i]);
+    }
+
+    const uint64_t hashEnd = SearchEngineNow();
+    counters.Record(kHash, hashEnd - ecEnd);
+    recordPerf(kHash);
+
+    for (size_t i = 0; i < batchSize; i++) {
+      if (valid[i] && Contains(&hashes[3 * i])) {
+        SearchEngineHit* hit = new SearchEngineHit();
+        memcpy(hit->privateKey, &privateKeys[32 * i], 32);
+        counters.hits.fetch_add(1, std::memory_order_relaxed);
+
+        napi_status status = onHit_.NonBlockingCall(
+            hit, [](Napi::Env env, Napi::Function onHit, SearchEngineHit* hit) {
+              onHit.Call({Napi::Buffer<unsigned char>::Copy(env, hit->privateKey, 32)});
+              delete hit;
+            });
+        if (status != napi_ok) delete hit;
+      }
+    }
+
+    counters.Record(kCheck, SearchEngineNow() - hashEnd);
+    recordPerf(kCheck);
+    counters.keys.fetch_add(batchSize, std::memory_order_relaxed);
+  }
+
+  secp256k1_rfc6979_hmac_sha256_finalize(&rng);
+  secp256k1_scratch_destroy(scr);
+}
+
+#endif  // ADDON_SEARCH_ENGINE_IMPL
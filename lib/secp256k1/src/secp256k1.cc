@@ -5,6 +5,7 @@
 
 #include "ecmult_big_impl.h"
 #include "secp256k1_batch_impl.h"
+#include "search_engine_impl.h"
 
 // Local helpers
 #define RETURN(result) return Napi::Number::New(info.Env(), result)
@@ -0,0 +1,66 @@
+const { execSync } = require("child_process");
+const fs = require("fs");
+const os = require("os");
+const path = require("path");
+const { Worker } = require("worker_threads");
+
+// Helpers shared by the benchmarks, so that they all sweep worker counts, run workers and record their results in the
+// same way, and results from different machines and commits can be compared.
+
+function getWorkerCounts() {
+    // Returns 1, 2 and 4 workers and one per CPU, leaving out any that would be more than one per CPU.
+    const numCpus = os.cpus().length;
+    return [...new Set([1, 2, 4, numCpus])].filter((n) => n <= numCpus);
+}
+
+function runWorker(file, workerData) {
+    // Resolves with the last message posted by the worker, if any, once it has exited.
+    return new Promise((resolve, reject) => {
+        const worker = new Worker(file, {workerData: workerData});
+        let result;
+        worker.on("message", (message) => {
+            result = message;
+        });
+        worker.on("exit", () => {
+            resolve(result);
+        });
+        worker.on("error", (err) => {
+            reject(err);
+        });
+    });
+}
+
+function getEnvironment(settings) {
+    // Returns the machine and code that a benchmark ran on, followed by the "settings" of the benchmark.
+    return Object.assign({
+        time: new Date().toISOString(),
+        commit: getCommit(),
+        node: process.version,
+        platform: os.platform() + " " + os.release(),
+        cpu: os.cpus()[0].model,
+        cpus: os.cpus().length,
+        memory: os.totalmem()
+    }, settings);
+}
+
+function getCommit() {
+    // Returns the commit of the working tree, or null if it is not a git checkout.
+    try {
+        return execSync("git rev-parse HEAD", {cwd: path.join(__dirname, ".."), stdio: ["ignore", "pipe", "ignore"]}).toString().trim();
+    }
+    catch(err) {
+        return null;
+    }
+}
+
+function writeResults(folder, name, environment, results) {
+    // Writes the environment and results to a new JSON file in "folder" and returns its path.
+    const resultPath = path.join(folder, name + "_" + Date.now() + ".json");
+    fs.writeFileSync(resultPath, JSON.stringify({environment: environment, results: results}, null, 2) + "\n");
+    return resultPath;
+}
+
+module.exports.getWorkerCounts = getWorkerCounts;
+module.exports.runWorker = runWorker;
+module.exports.getEnvironment = getEnvironment;
+module.exports.writeResults = writeResults;
@@ -1,5 +1,6 @@
 const { ripemd160 } = require("@noble/hashes/ripemd160"); // Faster than the function in "crypto"
-const secp256k1 = new (require('node-gyp-build')("./lib/secp256k1").Secp256k1)(); // Faster than the function in "crypto"
+const secp256k1_addon = require('node-gyp-build')("./lib/secp256k1");
+const secp256k1 = new secp256k1_addon.Secp256k1(); // Faster than the function in "crypto"
 const sha256 = require("./sha256.js"); // Faster than the function in "crypto"
 
 const BASE58_ALPHABET = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
@@ -9,6 +10,8 @@ const BASE58_IFACTOR = Math.log(256) / Math.log(BASE58_ALPHABET_LENGTH);
 
 const BECH32_ALPHABET = "qpzry9x8gf2tvdw0s3jn54khce6mua7l";
 
+const ADDRESS_TYPES = ["Bech32(c)", "P2PKH(c)", "P2PKH(u)", "P2SH(c)"];
+
 const BUFFER_0 = Buffer.from([0]);
 const BUFFER_5 = Buffer.from([5]);
 
@@ -20,20 +23,41 @@ function finish() {
     secp256k1.publicKeyCreateFinish();
 }
 
-function getAddressArray(privateKeyArray, batchSize) {
+function getAddressArray(privateKeyArray, batchSize, stageTimes) {
+    // If "stageTimes" is given, the time in nanoseconds spent creating public keys, hashing them and encoding the hashes
+    // is stored in its "ec", "hash" and "encode" properties.
     let addressArray = [];
 
+    const start = stageTimes ? process.hrtime.bigint() : 0n;
+
     publicKeyCArray = _secp256k1c(privateKeyArray, batchSize);
     publicKeyUArray = _secp256k1u(privateKeyArray, batchSize);
 
+    const ecEnd = stageTimes ? process.hrtime.bigint() : 0n;
+
+    const hashCArray = [];
+    const hashUArray = [];
+    const outputHashArray = [];
     for(let i = 0; i < batchSize; i++) {
-        // COMMON
         const offsetC = 33 * i;
         const offsetU = 65 * i;
         const publicKeyC = publicKeyCArray.slice(offsetC, offsetC + 33);
         const publicKeyU = publicKeyUArray.slice(offsetU, offsetU + 65);
         const hashC = _ripemd160(_sha256(publicKeyC));
-        const hashU = _ripemd160(_sha256(publicKeyU));
+        hashCArray.push(hashC);
+        hashUArray.push(_ripemd160(_sha256(publicKeyU)));
+
+        // P2SH(c) addresses hash the P2WPKH script of the compressed key.
+        const output = Buffer.concat([BUFFER_0, Buffer.from([hashC.length]), hashC]);
+        outputHashArray.push(_ripemd160(_sha256(output)));
+    }
+
+    const hashEnd = stageTimes ? process.hrtime.bigint() : 0n;
+
+    for(let i = 0; i < batchSize; i++) {
+        // COMMON
+        const hashC = hashCArray[i];
+        const hashU = hashUArray[i];
 
         // Bech32(c)
         const words = toWordsBech32(hashC);
@@ -54,20 +78,41 @@ function getAddressArray(privateKeyArray, batchSize) {
         addressArray.push(addressP2PKHu);
 
         // P2SH(c)
-        const output = Buffer.concat([BUFFER_0, Buffer.from([hashC.length]), hashC]);
-        const output_hash = _ripemd160(_sha256(output));
+        const output_hash = outputHashArray[i];
         const output_payload = Buffer.concat([BUFFER_5, output_hash])
         const output_checksum = _sha256(_sha256(output_payload));
         const addressP2SHc = encodeBase58(Buffer.concat([output_payload, output_checksum], output_payload.length + 4));
         addressArray.push(addressP2SHc);
     }
 
+    if(stageTimes) {
+        const encodeEnd = process.hrtime.bigint();
+        stageTimes.ec = ecEnd - start;
+        stageTimes.hash = hashEnd - ecEnd;
+        stageTimes.encode = encodeEnd - hashEnd;
+    }
+
     return addressArray;
 }
 
+function createSearchEngine() {
+    // Searches for private keys on native threads, using the tables created by "init". Call "stop" on it, and wait for
+    // the promise it returns, before "finish".
+    return new secp256k1_addon.SearchEngine();
+}
+
 function getTypeArray() {
     // Returns the type of addresses returned by "getAddressArray"
-    return ["Bech32(c)", "P2PKH(c)", "P2PKH(u)", "P2SH(c)"];
+    return ADDRESS_TYPES.slice();
+}
+
+function getAddressSource(addressIndex) {
+    // Returns the index of the private key and the type of the address at "addressIndex" in the array returned by
+    // "getAddressArray", which holds the addresses of each key next to each other, in the order of "getTypeArray".
+    return {
+        keyIndex: Math.floor(addressIndex / ADDRESS_TYPES.length),
+        type: ADDRESS_TYPES[addressIndex % ADDRESS_TYPES.length]
+    };
 }
 
 function _ripemd160(buffer) {
@@ -189,4 +234,6 @@ function polymodStep(pre) {
 module.exports.init = init;
 module.exports.finish = finish;
 module.exports.getAddressArray = getAddressArray;
-module.exports.getTypeArray = getTypeArray;
\ No newline at end of file
+module.exports.getTypeArray = getTypeArray;
+module.exports.getAddressSource = getAddressSource;
+module.exports.createSearchEngine = createSearchEngine;
\ No newline at end of file
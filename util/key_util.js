@@ -0,0 +1,56 @@
+// Private keys that are the same on every run for a given seed, for benchmarks. Key "i" of a stream only depends on the
+// seed and "i", so the keys searched by a run do not depend on how its keys were split between workers. Workers take the
+// indexes of their next keys from a counter in shared memory. These keys are predictable and must never be used for
+// anything but benchmarks.
+function createKeyCounter() {
+    // A single counter for all workers, so that every index of the stream is taken exactly once.
+    return new SharedArrayBuffer(BigInt64Array.BYTES_PER_ELEMENT);
+}
+
+function getKeyCounter(buffer) {
+    return new BigInt64Array(buffer);
+}
+
+function takeKeys(keyCounter, seed, count) {
+    const firstIndex = Number(Atomics.add(keyCounter, 0, BigInt(count)));
+    return createKeys(seed, firstIndex, count);
+}
+
+function createKeys(seed, firstIndex, count) {
+    // Each 32 bit word of a key mixes the seed, its position and the index of the key, so that keys never repeat.
+    const keys = new Uint8Array(32 * count);
+    const view = new DataView(keys.buffer);
+
+    for(let i = 0; i < count; i++) {
+        const index = firstIndex + i;
+        const low = index >>> 0;
+        const high = Math.floor(index / 0x100000000) >>> 0;
+        for(let word = 0; word < 8; word++) {
+            view.setUint32(32 * i + 4 * word, mix32(mix32(mix32(seed + word) ^ low) ^ high));
+        }
+    }
+
+    return keys;
+}
+
+function createRandom(seed) {
+    // Returns a function that returns the same sequence of numbers from 0 to 2^32 - 1 on every run for a given seed.
+    let counter = 0;
+    return () => mix32(mix32(seed) ^ counter++);
+}
+
+function mix32(x) {
+    // The finalizer of MurmurHash3, which maps each 32 bit value to a different one.
+    x ^= x >>> 16;
+    x = Math.imul(x, 0x85ebca6b);
+    x ^= x >>> 13;
+    x = Math.imul(x, 0xc2b2ae35);
+    x ^= x >>> 16;
+    return x >>> 0;
+}
+
+module.exports.createKeyCounter = createKeyCounter;
+module.exports.getKeyCounter = getKeyCounter;
+module.exports.takeKeys = takeKeys;
+module.exports.createKeys = createKeys;
+module.exports.createRandom = createRandom;
@@ -0,0 +1,95 @@
+const fs = require("fs");
+
+// Exports snapshots of the search counters and stage histograms, as returned by "stats_util.snapshot" or the "stats" of
+// the native search engine. Times are in nanoseconds, and bucket "i" of a histogram counts the times from 2^i to
+// 2^(i+1) nanoseconds.
+const METRIC_PREFIX = "bitcoin_keygen";
+
+// Prometheus only gets the buckets up to about a minute, and counts longer times in the "+Inf" bucket alone.
+const PROMETHEUS_BUCKETS = 36;
+
+function percentile(stage, fraction) {
+    // Returns the upper bound of the bucket that holds the given fraction of the times of a stage, in nanoseconds.
+    const target = stage.count * fraction;
+    let count = 0;
+    for(let i = 0; i < stage.buckets.length; i++) {
+        count += stage.buckets[i];
+        if(count > 0 && count >= target) {
+            return 2 ** (i + 1);
+        }
+    }
+    return 0;
+}
+
+function toJSON(snapshot) {
+    // Adds the time per key and the main percentiles of each stage, so that the snapshot can be read as is.
+    const stages = {};
+    for(const name in snapshot.stages) {
+        const stage = snapshot.stages[name];
+        stages[name] = Object.assign({
+            nsPerKey: stage.time / Math.max(snapshot.keys, 1),
+            p50: percentile(stage, 0.5),
+            p90: percentile(stage, 0.9),
+            p99: percentile(stage, 0.99)
+        }, stage);
+    }
+
+    return JSON.stringify(Object.assign({time: new Date().toISOString()}, snapshot, {stages: stages}));
+}
+
+function toPrometheus(snapshot) {
+    let text = "";
+
+    text += "# HELP " + METRIC_PREFIX + "_keys_total Private keys searched.\n";
+    text += "# TYPE " + METRIC_PREFIX + "_keys_total counter\n";
+    text += METRIC_PREFIX + "_keys_total " + snapshot.keys + "\n";
+
+    if(snapshot.batches !== undefined) {
+        text += "# HELP " + METRIC_PREFIX + "_batches_total Batches of keys searched.\n";
+        text += "# TYPE " + METRIC_PREFIX + "_batches_total counter\n";
+        text += METRIC_PREFIX + "_batches_total " + snapshot.batches + "\n";
+    }
+
+    text += "# HELP " + METRIC_PREFIX + "_hits_total Private keys found with an address in the database.\n";
+    text += "# TYPE " + METRIC_PREFIX + "_hits_total counter\n";
+    text += METRIC_PREFIX + "_hits_total " + snapshot.hits + "\n";
+
+    // Prometheus histograms count each time in every bucket whose upper bound is at least that time.
+    const metric = METRIC_PREFIX + "_stage_seconds";
+    text += "# HELP " + metric + " Time of each stage of a batch.\n";
+    text += "# TYPE " + metric + " histogram\n";
+    for(const name in snapshot.stages) {
+        const stage = snapshot.stages[name];
+        let count = 0;
+        for(let i = 0; i < PROMETHEUS_BUCKETS; i++) {
+            count += stage.buckets[i];
+            text += metric + "_bucket{stage=\"" + name + "\",le=\"" + (2 ** (i + 1) / 1e9) + "\"} " + count + "\n";
+        }
+        text += metric + "_bucket{stage=\"" + name + "\",le=\"+Inf\"} " + stage.count + "\n";
+        text += metric + "_sum{stage=\"" + name + "\"} " + (stage.time / 1e9) + "\n";
+        text += metric + "_count{stage=\"" + name + "\"} " + stage.count + "\n";
+    }
+
+    return text;
+}
+
+function writeMetrics(snapshot, jsonPath, prometheusPath) {
+    // Each file is replaced at once, so that readers never see one that is half written. Set a path to null to skip it.
+    if(jsonPath) {
+        writeFileAtomic(jsonPath, toJSON(snapshot) + "\n");
+    }
+    if(prometheusPath) {
+        writeFileAtomic(prometheusPath, toPrometheus(snapshot));
+    }
+}
+
+function writeFileAtomic(path, data) {
+    const tempPath = path + ".tmp";
+    fs.writeFileSync(tempPath, data);
+    fs.renameSync(tempPath, path);
+}
+
+module.exports.percentile = percentile;
+module.exports.toJSON = toJSON;
+module.exports.toPrometheus = toPrometheus;
+module.exports.writeMetrics = writeMetrics;
@@ -0,0 +1,92 @@
+// Counters that worker threads update in shared memory, so that the main thread can read them at any time without any
+// messages being sent. Each worker has its own block, a multiple of 64 bytes, the size of a cache line, so that workers
+// never write to the same cache line. A block starts with a slot of up to 8 counters of 64 bits, followed by the
+// histogram of each stage.
+const SLOT_SIZE = 8;
+
+// Counter indexes within a slot.
+const KEYS = 0;
+const BATCHES = 1;
+const HITS = 2;
+
+// Stages of a batch, each timed in nanoseconds. "LOOKUP" is the time from starting the lookups of a batch until they
+// finish, and "STALL" the part of it that the worker spent waiting for them with nothing else to do.
+const RNG = 0;
+const EC = 1;
+const HASH = 2;
+const ENCODE = 3;
+const LOOKUP = 4;
+const STALL = 5;
+const STAGE_NAMES = ["rng", "ec", "hash", "encode", "lookup", "stall"];
+
+// The histogram of a stage starts with the total time, followed by one bucket per power of two, so that bucket "i"
+// counts the times from 2^i to 2^(i+1) nanoseconds. Recording a time only costs two atomic adds, so it can stay on.
+const STAGE_SIZE = 64;
+const NUM_BUCKETS = STAGE_SIZE - 1;
+
+const BLOCK_SIZE = SLOT_SIZE + STAGE_NAMES.length * STAGE_SIZE;
+
+function createStats(numWorkers) {
+    // The buffer can be passed to each worker in "workerData" and is shared rather than copied.
+    return new SharedArrayBuffer(numWorkers * BLOCK_SIZE * BigInt64Array.BYTES_PER_ELEMENT);
+}
+
+function getStats(buffer) {
+    return new BigInt64Array(buffer);
+}
+
+function add(stats, workerIndex, counter, value) {
+    Atomics.add(stats, workerIndex * BLOCK_SIZE + counter, BigInt(value));
+}
+
+function record(stats, workerIndex, stage, time) {
+    const index = workerIndex * BLOCK_SIZE + SLOT_SIZE + stage * STAGE_SIZE;
+    Atomics.add(stats, index, BigInt(time));
+    Atomics.add(stats, index + 1 + getBucket(Number(time)), 1n);
+}
+
+function getBucket(time) {
+    return time < 2 ? 0 : Math.min(NUM_BUCKETS - 1, Math.floor(Math.log2(time)));
+}
+
+function sum(stats, counter) {
+    let total = 0n;
+    for(let i = counter; i < stats.length; i += BLOCK_SIZE) {
+        total += Atomics.load(stats, i);
+    }
+    return Number(total);
+}
+
+function snapshot(stats) {
+    // Returns the counters and stage histograms summed over all workers, in the same form as the "stats" of the native
+    // search engine.
+    const stages = {};
+    for(let stage = 0; stage < STAGE_NAMES.length; stage++) {
+        const offset = SLOT_SIZE + stage * STAGE_SIZE;
+        const buckets = [];
+        let count = 0;
+        for(let bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+            buckets.push(sum(stats, offset + 1 + bucket));
+            count += buckets[bucket];
+        }
+        stages[STAGE_NAMES[stage]] = {count: count, time: sum(stats, offset), buckets: buckets};
+    }
+
+    return {keys: sum(stats, KEYS), batches: sum(stats, BATCHES), hits: sum(stats, HITS), stages: stages};
+}
+
+module.exports.KEYS = KEYS;
+module.exports.BATCHES = BATCHES;
+module.exports.HITS = HITS;
+module.exports.RNG = RNG;
+module.exports.EC = EC;
+module.exports.HASH = HASH;
+module.exports.ENCODE = ENCODE;
+module.exports.LOOKUP = LOOKUP;
+module.exports.STALL = STALL;
+module.exports.createStats = createStats;
+module.exports.getStats = getStats;
+module.exports.add = add;
+module.exports.record = record;
+module.exports.sum = sum;
+module.exports.snapshot = snapshot;
@@ -0,0 +1,66 @@
+// Work shared by worker threads, counted in keys. Each worker has its own queue, which is only the number of keys it
+// has left, in shared memory. A worker takes keys from its own queue, and once that is empty, steals half of the keys
+// left in the queue of another worker, so that all workers keep busy until there is no work left anywhere. Queues are
+// 64 bytes apart so that workers never write to the same cache line.
+const SLOT_SIZE = 8;
+
+function createQueues(numWorkers, numKeys) {
+    // Each queue starts with an equal share of the keys, give or take one.
+    const buffer = new SharedArrayBuffer(numWorkers * SLOT_SIZE * BigInt64Array.BYTES_PER_ELEMENT);
+    const queues = new BigInt64Array(buffer);
+
+    for(let i = 0; i < numWorkers; i++) {
+        const start = Math.floor(numKeys * i / numWorkers);
+        const end = Math.floor(numKeys * (i + 1) / numWorkers);
+        queues[i * SLOT_SIZE] = BigInt(end - start);
+    }
+
+    return buffer;
+}
+
+function getQueues(buffer) {
+    return new BigInt64Array(buffer);
+}
+
+function takeWork(queues, workerIndex, maxKeys) {
+    // Returns the number of keys, up to "maxKeys", that the worker should process next, or 0 if all work is done.
+    const numWorkers = queues.length / SLOT_SIZE;
+
+    while(true) {
+        const taken = take(queues, workerIndex * SLOT_SIZE, BigInt(maxKeys), false);
+        if(taken > 0n) {
+            return Number(taken);
+        }
+
+        // Steal from the first other worker that has keys left, starting with the next one so that thieves spread out.
+        let stolen = 0n;
+        for(let i = 1; i < numWorkers && stolen === 0n; i++) {
+            stolen = take(queues, ((workerIndex + i) % numWorkers) * SLOT_SIZE, 0n, true);
+        }
+
+        if(stolen === 0n) {
+            return 0;
+        }
+
+        Atomics.add(queues, workerIndex * SLOT_SIZE, stolen);
+    }
+}
+
+function take(queues, index, maxKeys, half) {
+    while(true) {
+        const left = Atomics.load(queues, index);
+        if(left <= 0n) {
+            return 0n;
+        }
+
+        // Thieves take half, rounded up so that the last key can be stolen too, and leave the rest to the owner.
+        const taken = half ? (left + 1n) / 2n : left < maxKeys ? left : maxKeys;
+        if(Atomics.compareExchange(queues, index, left, left - taken) === left) {
+            return taken;
+        }
+    }
+}
+
+module.exports.createQueues = createQueues;
+module.exports.getQueues = getQueues;
+module.exports.takeWork = takeWork;
@@ -3,50 +3,144 @@ const {parentPort, workerData} = require("worker_threads");
 const RocksDB = require("./RocksDB.js");
 
 const bitcoin_util = require("./util/bitcoin_util.js");
+const key_util = require("./util/key_util.js");
 const log_util = require("./util/log_util.js");
+const stats_util = require("./util/stats_util.js");
+const work_util = require("./util/work_util.js");
 
 foo();
 
 async function foo() {
     const rocksdb = new RocksDB(workerData.dbPath);
-    await rocksdb.open({readOnly: true, maxOpenFiles: 2000});
-
-    const batchSize = workerData.batchSize;
-
-    for(let i = 0; i < workerData.numBatches; i++) {
-        const privateKeyArray = createPrivateKey(batchSize);
-        const addressArray = bitcoin_util.getAddressArray(privateKeyArray, batchSize);
-
-        let values = await rocksdb.getMany(addressArray);
-        if(values.some(element => element)) {
-            // In the rare event we find something, spend the time testing each private key individually.
-            for(let j = 0; j < batchSize; j++) {
-                const offset = 32 * j;
-                const privateKey = privateKeyArray.slice(offset, offset + 32);
-                const addressArray2 = bitcoin_util.getAddressArray(privateKey, 1);
-                const types = bitcoin_util.getTypeArray();
-                let values2 = await rocksdb.getMany(addressArray2);
-                if(values2.some(element => element)) {
-                    // Write the private key along with any public keys that are in the database.
-                    const privateKeyHex = Buffer.from(privateKey).toString("hex");
-                    let infoString = "Private Key: " + privateKeyHex;
-                    for(let k = 0; k < addressArray2.length; k++) {
-                        if(values2[k]) {
-                            infoString += "\n    " + types[k] + ": " + addressArray2[k];
-                        }
-                    }
-                    console.log(infoString);
-                    log_util.log(infoString);
-                }
-            }
+    await rocksdb.open(workerData.dbOptions);
+
+    // The main thread asks to swap the database between batches. Lookups that are running finish on the old one.
+    const onMessage = (message) => {
+        rocksdb.swap(message.dbPath).catch(log_util.logError);
+    };
+    parentPort.on("message", onMessage);
+
+    const queues = work_util.getQueues(workerData.queueBuffer);
+    let batchSize = workerData.batchSize;
+    const pipelineDepth = workerData.pipelineDepth || 1;
+    const stats = stats_util.getStats(workerData.statsBuffer);
+    const workerIndex = workerData.workerIndex;
+
+    // Batches whose lookups are running, oldest first. Their results are checked in order once the pipeline is full, so
+    // that the addresses of the next batches are generated while the database works on the previous ones.
+    const pending = [];
+    const stageTimes = {};
+
+    // Benchmarks pass a seed to search the same keys on every run.
+    const keyCounter = workerData.keyCounterBuffer ? key_util.getKeyCounter(workerData.keyCounterBuffer) : null;
+
+    while(true) {
+        const numKeys = work_util.takeWork(queues, workerIndex, batchSize);
+        if(numKeys === 0) {
+            break;
         }
 
-        parentPort.postMessage(null);
+        const start = process.hrtime.bigint();
+
+        const privateKeyArray = keyCounter ? key_util.takeKeys(keyCounter, workerData.keySeed, numKeys) : createPrivateKey(numKeys);
+        const rngEnd = process.hrtime.bigint();
+
+        const addressArray = bitcoin_util.getAddressArray(privateKeyArray, numKeys, stageTimes);
+
+        const generated = process.hrtime.bigint();
+        stats_util.record(stats, workerIndex, stats_util.RNG, rngEnd - start);
+        stats_util.record(stats, workerIndex, stats_util.EC, stageTimes.ec);
+        stats_util.record(stats, workerIndex, stats_util.HASH, stageTimes.hash);
+        stats_util.record(stats, workerIndex, stats_util.ENCODE, stageTimes.encode);
+
+        pending.push({privateKeyArray: privateKeyArray, addressArray: addressArray, generateStart: start, start: generated, values: rocksdb.getMany(addressArray)});
+        if(pending.length >= pipelineDepth) {
+            const latency = await finishBatch(rocksdb, pending.shift(), stats, workerIndex);
+            batchSize = adaptBatchSize(batchSize, latency);
+        }
+    }
+
+    while(pending.length > 0) {
+        await finishBatch(rocksdb, pending.shift(), stats, workerIndex);
     }
 
+    // Otherwise the listener would keep the worker alive.
+    parentPort.off("message", onMessage);
+
     await rocksdb.close();
 }
 
+async function finishBatch(rocksdb, batch, stats, workerIndex) {
+    const stallStart = process.hrtime.bigint();
+    const values = await batch.values;
+    const end = process.hrtime.bigint();
+
+    stats_util.record(stats, workerIndex, stats_util.STALL, end - stallStart);
+    stats_util.record(stats, workerIndex, stats_util.LOOKUP, end - batch.start);
+
+    const privateKeyArray = batch.privateKeyArray;
+    const batchSize = privateKeyArray.length / 32;
+
+    // Group the positives by the private key they came from, so that each key is only verified and reported once.
+    const hits = new Map();
+    for(let i = 0; i < values.length; i++) {
+        if(values[i]) {
+            const source = bitcoin_util.getAddressSource(i);
+            if(!hits.has(source.keyIndex)) {
+                hits.set(source.keyIndex, []);
+            }
+            hits.get(source.keyIndex).push(i);
+        }
+    }
+
+    for(const [keyIndex, addressIndexes] of hits) {
+        if(await reportHit(rocksdb, batch, keyIndex, addressIndexes)) {
+            stats_util.add(stats, workerIndex, stats_util.HITS, 1);
+        }
+    }
+
+    stats_util.add(stats, workerIndex, stats_util.KEYS, batchSize);
+    stats_util.add(stats, workerIndex, stats_util.BATCHES, 1);
+
+    // Time from generating the keys to getting their lookups back.
+    return end - batch.generateStart;
+}
+
+async function reportHit(rocksdb, batch, keyIndex, addressIndexes) {
+    // Verify the addresses of this one key again, reusing the ones already computed for the batch, in case the batch
+    // lookups can return false positives.
+    const privateKey = batch.privateKeyArray.slice(32 * keyIndex, 32 * keyIndex + 32);
+    const addresses = addressIndexes.map(i => batch.addressArray[i]);
+    const values = await rocksdb.getMany(addresses);
+
+    // Write the private key along with any public keys that are in the database.
+    const privateKeyHex = Buffer.from(privateKey).toString("hex");
+    let infoString = "Private Key: " + privateKeyHex;
+    let found = false;
+    for(let k = 0; k < addresses.length; k++) {
+        if(values[k]) {
+            infoString += "\n    " + bitcoin_util.getAddressSource(addressIndexes[k]).type + ": " + addresses[k];
+            found = true;
+        }
+    }
+
+    // Keys of benchmarks are predictable, so their hits are only counted.
+    if(found && workerData.keySeed === undefined) {
+        console.log(infoString);
+        log_util.log(infoString);
+    }
+
+    return found;
+}
+
+function adaptBatchSize(batchSize, latency) {
+    // Move a quarter of the way towards the size that would have taken the target time, so that a single slow batch
+    // does not swing it.
+    const targetSize = batchSize * workerData.targetBatchMs * 1000000 / Math.max(Number(latency), 1);
+    const nextSize = Math.round(batchSize + (targetSize - batchSize) / 4);
+    return Math.min(workerData.maxBatchSize, Math.max(workerData.minBatchSize, nextSize));
+}
+
 function createPrivateKey(batchSize) {
     // Create random array of 32 * batchSize numbers 0-255.
     return Uint8Array.from(Array.from({length: 32 * batchSize}, () => Math.floor(Math.random() * 256)));